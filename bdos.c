@@ -19,3 +19,126 @@ Drive bd_cur_drv()
   return bdos (BDOS_DGET, 0) + 1;
   }
 
+
+/*===========================================================================
+
+  bd_cur_usr
+
+===========================================================================*/
+int bd_cur_usr()
+  {
+  return bdos (BDOS_USER, 0xFF);
+  }
+
+/*===========================================================================
+
+  bd_sel_drv
+
+===========================================================================*/
+void bd_sel_drv (drive)
+Drive drive;
+  {
+  bdos (BDOS_SELECT, drive - 1);
+  }
+
+/*===========================================================================
+
+  bd_dpb
+
+===========================================================================*/
+uint8_t *bd_dpb ()
+  {
+  return (uint8_t *)bdos (BDOS_DPB, 0);
+  }
+
+/*===========================================================================
+
+  bd_ver
+
+===========================================================================*/
+static int bdos_ver = 0;
+
+int bd_ver ()
+  {
+  if (bdos_ver == 0)
+    bdos_ver = bdos (BDOS_VER, 0) & 0xFF;
+  return bdos_ver;
+  }
+
+/*===========================================================================
+
+  bd_secs
+
+  BDOS 105 fills in the day number, and the hour and minute in BCD, 
+  and returns the seconds, also in BCD. CP/M 2.2 has no such call. 
+
+===========================================================================*/
+#define BCD(b) (((b) >> 4) * 10 + ((b) & 0x0F))
+
+long bd_secs ()
+  {
+  uint8_t dat [4];
+  int sec;
+  if (bd_ver () < 0x30) return -1L;
+  sec = bdos (BDOS_TIME, dat) & 0xFF;
+  return (long)BD_WORD (dat) * 86400L + BCD (dat[2]) * 3600L 
+    + BCD (dat[3]) * 60L + BCD (sec);
+  }
+
+/*===========================================================================
+
+  bd_drv_ok
+
+  A drive in the login vector certainly exists. Otherwise, on CP/M 2.2,
+  ask the BIOS, whose SELDSK returns zero for a drive it doesn't have
+  -- the BDOS would print "Select" error and reboot. The BIOS must then
+  be put back on the BDOS's current drive, because the BDOS doesn't
+  select a drive it thinks is already selected. CP/M 3 can be told to
+  return errors instead, and doesn't allow direct BIOS calls, so there
+  the BDOS is asked to select the drive.
+
+===========================================================================*/
+#define DRV_UNKNOWN 0
+#define DRV_YES 1
+#define DRV_NO 2
+
+static uint8_t drv_state[26];
+
+BOOL bd_drv_ok (drive)
+Drive drive;
+  {
+  uint8_t *state;
+  unsigned login;
+  Drive cur;
+
+  if (drive < 1 || drive > 26) return FALSE;
+  state = &drv_state[drive - 1];
+  if (*state != DRV_UNKNOWN) return *state == DRV_YES;
+
+  /* Neither CP/M 2.2 nor 3 has more than A-P */
+  if (drive > 16)
+    {
+    *state = DRV_NO;
+    return FALSE;
+    }
+
+  login = bdos (BDOS_LOGIN, 0);
+  if (login & (1 << (drive - 1)))
+    *state = DRV_YES;
+  else if (bd_ver () >= 0x30)
+    {
+    cur = bd_cur_drv ();
+    bdos (BDOS_ERRMODE, 0xFF);
+    *state = (bdos (BDOS_SELECT, drive - 1) & 0xFF) ? DRV_NO : DRV_YES;
+    bdos (BDOS_ERRMODE, 0);
+    bd_sel_drv (cur);
+    }
+  else
+    {
+    cur = bd_cur_drv ();
+    *state = biosh (BIOS_SELDSK, drive - 1, 0) ? DRV_YES : DRV_NO;
+    biosh (BIOS_SELDSK, cur - 1, 1);
+    }
+  return *state == DRV_YES;
+  }
+
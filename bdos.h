@@ -14,12 +14,31 @@
 #define DMABUF 0x0080	/* Default DMA buffer address */
 
 /* BDOS syscall numbers */
+#define BDOS_VER 12
 #define BDOS_OPEN 15
 #define BDOS_CLOSE 16
 #define BDOS_DFIRST 17
 #define BDOS_DNEXT 18
+#define BDOS_DELETE 19
+#define BDOS_READ 20
+#define BDOS_WRITE 21
+#define BDOS_MAKE 22
+#define BDOS_RENAME 23
+#define BDOS_SELECT 14
+#define BDOS_LOGIN 24
 #define BDOS_DGET 25 
+#define BDOS_SETDMA 26
+#define BDOS_ALV 27
+#define BDOS_DPB 31
+#define BDOS_USER 32
+#define BDOS_RREAD 33
 #define BDOS_FSIZE 35 
+#define BDOS_MULTI 44
+#define BDOS_ERRMODE 45
+#define BDOS_TIME 105
+
+/* Most records BDOS_MULTI allows in one read or write (CP/M 3) */
+#define BD_MAX_MULTI 128
 
 /* Max filename, not including drive -- 8 + 3 */
 #define BD_MAX_FNAME 11
@@ -35,8 +54,67 @@
 
 #define BD_SEC_SZ 128
 
+/* Offsets of fields in a 32-byte directory entry (or FCB) */
+#define DE_EX 12	/* Extent number, low bits */
+#define DE_S2 14	/* Extent number, high bits */
+#define DE_RC 15	/* Records used in the entry's last logical extent */
+
+/* Records in one logical extent, and the extents per S2 unit */
+#define BD_EXT_RECS 128
+#define BD_S2_EXTS 32
+
+/* Highest valid user number. Directory entries with a larger value
+   in the user byte are deleted (0xE5) or not files at all. */
+#define BD_MAX_USER 15
+
+/* Offsets of fields in a disk parameter block */
+#define DPB_SPT 0	/* 128-byte records per track (word) */
+#define DPB_BSH 2	/* Block shift */
+#define DPB_BLM 3	/* Block mask */
+#define DPB_EXM 4	/* Extent mask */
+#define DPB_DSM 5	/* Highest block number (word) */
+#define DPB_DRM 7	/* Highest directory entry number (word) */
+#define DPB_OFF 13	/* Reserved tracks (word) */
+
+/* Offset of the sector translation table address in a disk 
+   parameter header */
+#define DPH_XLT 0
+
+/* A little-endian word in a DPB or DPH */
+#define BD_WORD(p) ((p)[0] | ((unsigned)(p)[1] << 8))
+
+/* BIOS entry numbers, counting from BOOT=0 */
+#define BIOS_SELDSK 9
+#define BIOS_SETTRK 10
+#define BIOS_SETSEC 11
+#define BIOS_SETDMA 12
+#define BIOS_READ 13
+#define BIOS_SECTRAN 16
+
 /** A=1, B=2... */
 extern Drive bd_cur_drv(); 
 
+/** 0-15 */
+extern int bd_cur_usr();
+
+/** Make drive (A=1, B=2...) the current drive. */
+extern void bd_sel_drv();
+
+/** The disk parameter block of the current drive. */
+extern uint8_t *bd_dpb();
+
+/** BDOS version, e.g., 0x22 for CP/M 2.2. It is only asked for 
+    once. */
+extern int bd_ver();
+
+/** Seconds since the CP/M 3 date epoch, from BDOS 105, or -1L if
+    the BDOS has no clock. Only useful for measuring intervals. */
+extern long bd_secs();
+
+/** TRUE if drive (A=1, B=2...) exists. Drives that are not logged in
+    are probed in a way that can't provoke a select error, and the
+    answers are remembered for the rest of the run. */
+extern BOOL bd_drv_ok();
+
 
 #endif /* bdos.h */
@@ -17,15 +17,20 @@
 #include "defs.h"
 #include "bdos.h"
 #include "dirs.h"
+#include "expand.h"
 #include "getopt.h"
 #include "error.h"
 #include "term.h"
+#include "recio.h"
 
 /* Display modes. */
 #define DF_LONG 0x01
 #define DF_PAGE 0x02
 
-char buff[256];
+/* Records read from a file at a time */
+#define CAT_RECS 8
+
+char buff[CAT_RECS * BD_SEC_SZ];
 
 /*===========================================================================
 
@@ -46,116 +51,83 @@ int lines = 0;
 
 /*===========================================================================
 
-  cat_do_file
+  cat_line
+
+  Count a line written, and wait for a key at the end of each page.
+
 ===========================================================================*/
-void cat_do_file (filename, d_flag)
-char *filename;
-uint8_t d_flag;
+void cat_line (page)
+BOOL page;
   {
-  BOOL page = d_flag & DF_PAGE;
-  FILE *f = fopen (filename, "r");
-  if (f)
+  if (lines++ ==  tm_rows - 2)
     {
-    char line[256];
-    while (fgets (line, tm_cols - 1, f))
+    while (lines == tm_rows - 1 && page)
       {
-      line [tm_cols] = 0;
-      printf ("%s", line);
-
-      if (lines++ ==  tm_rows - 2)
+      int c = tm_g_rchar(); 
+      switch (c)
         {
-        while (lines == tm_rows - 1 && page)
-          {
-          int c = tm_g_rchar(); 
-          switch (c)
-            {
-            case I_INTR: exit(0); 
-            case 13: case 10: lines = tm_rows - 2; break;
-            case ' ': lines = 0; 
-            default: break; 
-            }
-          }
+        case I_INTR: exit(0); 
+        case 13: case 10: lines = tm_rows - 2; break;
+        case ' ': lines = 0; 
+        default: break; 
         }
       }
-    fclose (f);
     }
-  else
-    fprintf (stderr, "%s: %s\r\n", filename, strerror (ENOENT));
   }
 
 /*===========================================================================
 
-  cat_expand
+  cat_do_file
+
+  The file is read a few records at a time, straight from the BDOS, 
+  up to the ^Z that ends a text file. CRs are dropped, because stdout
+  puts them back. A line that is too long for the screen counts as 
+  more than one, for paging.
 
-  On entry 'thing' may be a file, a file pattern including drive, or
-  just a drive. If there's a drive, the : must be in position 1, or it's
-  a bad filename.
 ===========================================================================*/
-void cat_expand (thing, d_flag)
-char *thing;
+void cat_do_file (filename, d_flag)
+char *filename;
 uint8_t d_flag;
   {
-  dirent **dirs;
-  char *path = thing;
-  Drive drive = 0;
-  int colpos;
-  BOOL page = FALSE;
-
-  if (d_flag & DF_PAGE)
-    page = TRUE;
-
-  colpos = strchr (thing, ':'); 
-  if (colpos)
+  BOOL page = d_flag & DF_PAGE;
+  riofile rf;
+  unsigned n;
+  int col = 0;
+  ErrCode err = rio_open (&rf, filename);
+  if (err)
     {
-    if (colpos == thing + 1)
-      {
-      path = thing + 2;
-      drive = thing[0] - 'A' + 1;
-      if (drive < 1 || drive > 26)
-        {
-	fprintf (stderr, "\n%c: %s\n", thing[0], strerror (E_DLET));
-        return;
-	}
-      }
-    else
-      {
-      fprintf (stderr, "\n%s: %s\n", thing, strerror (E_FNAME));
-      return;
-      }
+    fprintf (stderr, "%s: %s\r\n", filename, strerror (err));
+    return;
     }
 
-  if (!path[0]) path = "*";
-
-  dirs = dirs_list (drive, path, 0); /* don't sort or set size */
-  if (dirs)
+  do 
     {
-    int i = 0;
-    while (dirs[i]) 
+    char *p = buff;
+    char *end;
+    n = rio_read (&rf, buff, CAT_RECS);
+    end = buff + n * BD_SEC_SZ;
+    while (p < end)
       {
-      char fn[BD_MAX_PATH + 1];
-      Drive drive = dirs[i]->drive; 
-      if (dirs[i]->drive == 0)
-        drive = bd_cur_drv(); 
-
-      fn[0] = (drive - 1) + 'A';
-      fn[1] = ':';
-      strcpy (fn + 2, dirs[i]->sname);
-
-      cat_do_file (fn, d_flag);
-
-      i++;
+      char c = *p++;
+      if (c == RIO_EOF)
+        {
+        n = 0;
+        break;
+        }
+      if (c == '\r') continue;
+      putchar (c);
+      if (c == '\n' || ++col == tm_cols - 2)
+        {
+        col = 0;
+        cat_line (page);
+        }
       }
-    dirs_free (dirs);
-    if (i == 0)
-      fprintf (stderr, "%s: no files matched\r\n", thing); 
-
-    printf ("\r\n");
-    }
-  else
-    {
-    fprintf (stderr, "\n%s: %s\n", thing, strerror (errno));
-    return;
     }
+  while (n == CAT_RECS);
+
+  if (rf.err)
+    fprintf (stderr, "%s: %s\r\n", filename, strerror (rf.err));
+  rio_close (&rf);
   }
 
 /*===========================================================================
@@ -184,7 +156,7 @@ int main (argc, argv)
 int argc;
 char **argv;
   {
-  int i, opt;
+  int opt;
   uint8_t d_flag = 0;
 
   argv[0] = "cat";
@@ -217,14 +189,17 @@ char **argv;
     }
   else
     {
-    for (i = optind; i < argc; i++)
+    exargs *ex = ex_open (argc - optind, argv + optind, 0, 
+      EX_LITERAL | EX_WARN);
+    if (ex)
       {
-      char *arg = argv[i];
-      if (strchr (arg, '*') || strchr (arg, '?'))
-        cat_expand (argv[i], d_flag);
-      else 
-        cat_do_file (arg, d_flag);
+      char *fn;
+      while ((fn = ex_next (ex)))
+        cat_do_file (fn, d_flag);
+      ex_close (ex);
       }
+    else
+      fprintf (stderr, "%s: %s\r\n", argv[0], strerror (errno));
     }
 
   return 0;
@@ -19,5 +19,10 @@
 /* Character to send to get non-destructive backspace */
 #define O_BS 8
 
+/* The catalog written by "locate /u", and the temporary file it is
+   built in */
+#define LC_DB  "A:LOCATE.DB"
+#define LC_TMP "A:LOCATE.$$$"
+
 #endif
 
@@ -10,7 +10,6 @@
 ===========================================================================*/
 
 #include "stdio.h"
-#include "fcntl.h"
 #include "errno.h"
 #include "ctype.h"
 #include "config.h"
@@ -18,14 +17,386 @@
 #include "defs.h"
 #include "bdos.h"
 #include "dirs.h"
+#include "expand.h"
 #include "getopt.h"
 #include "error.h"
 #include "term.h"
+#include "recio.h"
+#include "crc.h"
 
 uint8_t buff[256];
 
 #define DF_VERB 0x01
 #define DF_PROG 0x02
+#define DF_UPD 0x04
+#define DF_CHK 0x08
+#define DF_RES 0x10
+#define DF_NOCL 0x20
+#define DF_ASK 0x40
+
+/* Largest copy buffer to try for, and the memory to leave free for 
+   directory lists */
+#define CP_MAXBUF 0xE000
+#define CP_RESERVE 0x1000
+
+/* The copy buffer, set up by cp_alloc(), and its size in records */
+uint8_t *cp_buf = buff;
+unsigned cp_nrecs = sizeof (buff) / BD_SEC_SZ;
+
+/* Files read into the copy buffer by cp_queue(), and not yet 
+   written */
+#define CP_BATCH 32
+
+typedef struct _cpfile
+  {
+  char from [BD_MAX_PATH + 1];
+  char to [BD_MAX_PATH + 1];
+  unsigned start;   /* First record in cp_buf */
+  unsigned nrecs;
+  unsigned crc;     /* Of the data, for /c */
+  } cpfile;
+
+cpfile cp_batch [CP_BATCH];
+int cp_nbatch = 0;
+/* Records of cp_buf holding batched files */
+unsigned cp_used = 0;
+
+/* Exit status: non-zero if any file failed verification, or the 
+   copy failed or stopped early */
+int cp_status = 0;
+
+/* Set if ctrl+c is pressed at a /i prompt */
+BOOL cp_stop = FALSE;
+
+/* Records written, for cp_drive() to report */
+long cp_copied = 0;
+
+/* Progress shown by /d: records to copy, records copied, and the
+   step last shown, out of CP_STEPS */
+#define CP_STEPS 10
+unsigned cp_total;
+unsigned cp_done;
+unsigned cp_step;
+
+/*===========================================================================
+
+  cp_alloc
+
+  Take the largest copy buffer that will fit, in whole kilobytes, 
+  while leaving CP_RESERVE bytes free. The whole buffer is filled 
+  from the source file before any of it is written, so that copying 
+  between two floppies doesn't move the heads between the drives for
+  every record. If there is no room at all, use the static buff.
+
+===========================================================================*/
+void cp_alloc ()
+  {
+  unsigned n;
+  for (n = CP_MAXBUF; n >= 1024; n -= 1024)
+    {
+    uint8_t *b = malloc (n + CP_RESERVE);
+    if (b)
+      {
+      free (b);
+      b = malloc (n);
+      if (b)
+        {
+        cp_buf = b;
+        cp_nrecs = n / BD_SEC_SZ;
+        }
+      return;
+      }
+    }
+  }
+
+/*===========================================================================
+
+  cp_show
+
+  Show the names of a file being copied, if /v is set. With /d, the
+  dots follow on the same line.
+
+===========================================================================*/
+void cp_show (from, to, d_flag)
+char *from;
+char *to;
+uint8_t d_flag;
+  {
+  if (d_flag & DF_VERB)
+    {
+    printf ("%s -> %s", from, to);
+    fflush (stdout);
+    if (!(d_flag & DF_PROG))
+      printf ("\r\n");
+    }
+  }
+
+/*===========================================================================
+
+  cp_prog_start, cp_prog
+
+  With /d, show how much of a file has been copied, as a percentage.
+  It is redrawn over itself with backspaces, and only when it has 
+  moved on by a step, so a file costs at most CP_STEPS updates 
+  however big it is.
+
+===========================================================================*/
+void cp_prog_start (total, d_flag)
+unsigned total;
+uint8_t d_flag;
+  {
+  if (d_flag & DF_PROG)
+    {
+    cp_total = total;
+    cp_done = 0;
+    cp_step = 0;
+    printf ("  0%%");
+    fflush (stdout);
+    }
+  }
+
+void cp_prog (nrecs, d_flag)
+unsigned nrecs;
+uint8_t d_flag;
+  {
+  unsigned step;
+  if (!(d_flag & DF_PROG)) return;
+  cp_done += nrecs;
+  if (cp_done >= cp_total)
+    step = CP_STEPS;
+  else
+    step = (unsigned)((long)cp_done * CP_STEPS / cp_total);
+  if (step > cp_step)
+    {
+    cp_step = step;
+    printf ("%c%c%c%c%3d%%", O_BS, O_BS, O_BS, O_BS, 
+      step * (100 / CP_STEPS));
+    fflush (stdout);
+    }
+  }
+
+/*===========================================================================
+
+  cp_clobber
+
+  Decide whether to copy over a file that already exists, for /n and 
+  /i. Returns TRUE to go ahead.
+
+===========================================================================*/
+BOOL cp_clobber (to, d_flag)
+char *to;
+uint8_t d_flag;
+  {
+  int c;
+  if (d_flag & DF_NOCL)
+    {
+    if (d_flag & DF_VERB)
+      printf ("%s: %s\r\n", to, strerror (EEXIST));
+    return FALSE;
+    }
+  printf ("Overwrite %s (y/n)? ", to);
+  fflush (stdout);
+  do
+    {
+    c = toupper (tm_g_rchar ());
+    if (c == I_INTR)
+      {
+      printf ("^C\r\n");
+      cp_stop = TRUE;
+      return FALSE;
+      }
+    }
+  while (c != 'Y' && c != 'N');
+  printf ("%c\r\n", c);
+  return c == 'Y';
+  }
+
+/*===========================================================================
+
+  cp_crc_file
+
+  Work out the CRC of a whole file, reading it into the part of the 
+  copy buffer that batched files are not using. Returns zero, or an
+  error code.
+
+===========================================================================*/
+ErrCode cp_crc_file (path, crc)
+char *path;
+unsigned *crc;
+  {
+  riofile f;
+  uint8_t *buf = cp_buf + cp_used * BD_SEC_SZ;
+  unsigned room = cp_nrecs - cp_used;
+  unsigned n;
+  ErrCode err = rio_open (&f, path);
+  if (err) return err;
+  *crc = CRC_INIT;
+  do
+    {
+    n = rio_read (&f, buf, room);
+    *crc = crc_update (*crc, buf, n * BD_SEC_SZ);
+    }
+  while (n == room && !f.err);
+  return f.err;
+  }
+
+/*===========================================================================
+
+  cp_verify
+
+  Read back a file that has been written, and compare its CRC with 
+  the CRC of the data that was written. A mismatch is reported, and 
+  sets the exit status, but doesn't stop the copy.
+
+===========================================================================*/
+void cp_verify (to, crc)
+char *to;
+unsigned crc;
+  {
+  unsigned got;
+  ErrCode err = cp_crc_file (to, &got);
+  if (!err && got != crc) 
+    err = E_VERIFY;
+  if (err)
+    {
+    fprintf (stderr, "%s: %s\r\n", to, strerror (err));
+    cp_status = E_VERIFY;
+    }
+  }
+
+/*===========================================================================
+
+  cp_same
+
+  Compare two records.
+
+===========================================================================*/
+BOOL cp_same (r1, r2)
+uint8_t *r1;
+uint8_t *r2;
+  {
+  int i;
+  for (i = 0; i < BD_SEC_SZ; i++)
+    if (r1[i] != r2[i]) return FALSE;
+  return TRUE;
+  }
+
+/*===========================================================================
+
+  cp_resume
+
+  See whether the copy from fin to fullto can carry on where an 
+  earlier one stopped. The destination must be no bigger than the
+  source, and its last record must match the source's record in the
+  same place. Then a random read (BDOS 33) of that record leaves each
+  file positioned there, and the copy goes on from it, writing the 
+  last record again in case it was only partly right. Returns TRUE,
+  with fout open, if so.
+
+===========================================================================*/
+BOOL cp_resume (fin, fout, fullto, d_flag)
+riofile *fin;
+riofile *fout;
+char *fullto;
+uint8_t d_flag;
+  {
+  unsigned have, last;
+  if (rio_open (fout, fullto)) return FALSE;
+  have = rio_size (fout);
+  if (have == 0 || have > rio_size (fin)) return FALSE;
+  last = have - 1;
+  if (rio_rread (fin, last, cp_buf) 
+      || rio_rread (fout, last, cp_buf + BD_SEC_SZ)
+      || !cp_same (cp_buf, cp_buf + BD_SEC_SZ))
+    {
+    /* Back to the start, for a full copy */
+    rio_rread (fin, 0, cp_buf);
+    return FALSE;
+    }
+  if (d_flag & DF_VERB)
+    printf ("%s(resuming at record %u)%s", 
+      (d_flag & DF_PROG) ? " " : "", last, 
+      (d_flag & DF_PROG) ? " " : "\r\n");
+  return TRUE;
+  }
+
+/*===========================================================================
+
+  cp_copy
+
+  Copy the open file fin to fullto, starting with the n records 
+  already read into the start of the buffer. If fout is 0, fullto is
+  created; otherwise fout is fullto, opened by cp_resume(). With /c, 
+  the CRC of the data is worked out as it goes, and the file is read
+  back at the end; after a resume, both whole files are read. Returns
+  TRUE on success.
+
+===========================================================================*/
+BOOL cp_copy (fin, fout, fullfrom, fullto, n, d_flag)
+riofile *fin;
+riofile *fout;
+char *fullfrom;
+char *fullto;
+unsigned n;
+uint8_t d_flag;
+  {
+  riofile rf;
+  BOOL resumed = fout != 0;
+  unsigned crc = CRC_INIT;
+  ErrCode err;
+  if (!resumed)
+    {
+    fout = &rf;
+    err = rio_create (fout, fullto);
+    if (err)
+      {
+      fprintf (stderr, "%s: %s\r\n", fullto, strerror (err));
+      return FALSE;
+      }
+    }
+
+  if (d_flag & DF_PROG)
+    {
+    /* After a resume, only what is left to copy counts */
+    unsigned total = rio_size (fin);
+    if (resumed) total -= rio_size (fout) - 1;
+    cp_prog_start (total, d_flag);
+    }
+
+  while (rio_write (fout, cp_buf, n) == n)
+    {
+    cp_copied += n;
+    if (d_flag & DF_CHK)
+      crc = crc_update (crc, cp_buf, n * BD_SEC_SZ);
+    cp_prog (n, d_flag);
+    if (n < cp_nrecs || fin->err) break;
+    n = rio_read (fin, cp_buf, cp_nrecs);
+    }
+
+  err = rio_close (fout);
+  if (d_flag & DF_PROG)
+    printf ("\r\n");
+  if (fin->err)
+    {
+    fprintf (stderr, "%s: %s\r\n", fullfrom, strerror (fin->err));
+    return FALSE;
+    }
+  if (fout->err || err)
+    {
+    fprintf (stderr, "%s: %s\r\n", fullto, 
+      strerror (fout->err ? fout->err : err));
+    return FALSE;
+    }
+
+  if (d_flag & DF_CHK)
+    {
+    if (resumed && (err = cp_crc_file (fullfrom, &crc)))
+      fprintf (stderr, "%s: %s\r\n", fullfrom, strerror (err));
+    else
+      cp_verify (fullto, crc);
+    }
+  return TRUE;
+  }
 
 /*===========================================================================
 
@@ -39,7 +410,8 @@ char *from;
 char *to;
 uint8_t d_flag;
   {
-  int fin, fout;
+  riofile fin, fout;
+  ErrCode err;
   char fullto [BD_MAX_PATH + 1];
   char fullfrom [BD_MAX_PATH + 1];
 
@@ -81,13 +453,7 @@ uint8_t d_flag;
     }
 
 
-  if (d_flag & DF_VERB)
-    {
-    printf ("%s -> %s", fullfrom, fullto);
-    fflush (stdout);
-    if (!(d_flag & DF_PROG))
-      printf ("\r\n");
-    }
+  cp_show (fullfrom, fullto, d_flag);
 
   if (strcmp (fullfrom, fullto) == 0)
     {
@@ -95,44 +461,149 @@ uint8_t d_flag;
     return FALSE;
     }
 
-  fin = open (fullfrom, O_RDONLY);
-  if (fin >= 0)
+  /* Only one file, so opening it is the cheapest way to see if it's
+     there. It is closed again at once, because cp_resume() or 
+     cp_copy() open it in their own way. */
+  if ((d_flag & (DF_NOCL | DF_ASK)) && rio_open (&fout, fullto) == 0)
+    {
+    rio_close (&fout);
+    if (!cp_clobber (fullto, d_flag)) return TRUE;
+    }
+
+  err = rio_open (&fin, fullfrom);
+  if (err)
+    {
+    fprintf (stderr, "%s: %s\r\n", fullfrom, strerror (err));
+    return FALSE;
+    }
+
+  if ((d_flag & DF_RES) && cp_resume (&fin, &fout, fullto, d_flag))
+    return cp_copy (&fin, &fout, fullfrom, fullto, 
+      rio_read (&fin, cp_buf, cp_nrecs), d_flag);
+  return cp_copy (&fin, 0, fullfrom, fullto, 
+    rio_read (&fin, cp_buf, cp_nrecs), d_flag);
+  }
+
+/*===========================================================================
+
+  cp_flush
+
+  Write out the files batched by cp_queue(), in the order they were
+  read. Stops at the first one that can't be written. Returns TRUE if
+  all were written. With /c, the files are read back once they have
+  all been written, when the buffer is free again.
+
+===========================================================================*/
+BOOL cp_flush (d_flag)
+uint8_t d_flag;
+  {
+  int i, done = 0;
+  BOOL ok = TRUE;
+  for (i = 0; ok && i < cp_nbatch; i++)
     {
-    fout = open (fullto, O_WRONLY | O_CREAT | O_TRUNC);
-    if (fout >= 0)
+    cpfile *c = &cp_batch[i];
+    riofile fout;
+    ErrCode err;
+    cp_show (c->from, c->to, d_flag);
+    if (d_flag & DF_CHK)
+      c->crc = crc_update (CRC_INIT, cp_buf + c->start * BD_SEC_SZ, 
+        c->nrecs * BD_SEC_SZ);
+    err = rio_create (&fout, c->to);
+    if (!err)
       {
-      int n = read (fin, &buff, sizeof (buff));
-      while (n > 0)
-        {
-        write (fout, &buff, n);
-        n = read (fin, &buff, sizeof (buff));
-        if (d_flag & DF_PROG)
-          {
-          printf (".");
-          fflush (stdout);
-          }
-        }
-      close (fout);
+      cp_copied += rio_write (&fout, cp_buf + c->start * BD_SEC_SZ, 
+        c->nrecs);
+      cp_prog_start (c->nrecs, d_flag);
+      cp_prog (c->nrecs, d_flag);
+      err = rio_close (&fout);
+      if (fout.err) err = fout.err;
       if (d_flag & DF_PROG)
         printf ("\r\n");
-      if (n < 0)
-        {
-        fprintf (stderr, "%s: %s\r\n", fullto, strerror (errno));
-        }
       }
-    else
+    if (err)
       {
-      fprintf (stderr, "%s: %s\r\n", fullto, strerror (errno));
-      return FALSE;
+      fprintf (stderr, "%s: %s\r\n", c->to, strerror (err));
+      ok = FALSE;
       }
-    close (fin);
+    else
+      done++;
     }
-  else
+  cp_used = 0;
+  if (d_flag & DF_CHK)
+    for (i = 0; i < done; i++)
+      cp_verify (cp_batch[i].to, cp_batch[i].crc);
+  cp_nbatch = 0;
+  return ok;
+  }
+
+/*===========================================================================
+
+  cp_queue
+
+  Copy a file as part of a batch. If it fits in what's left of the 
+  buffer, it's only read now, and cp_flush() writes it later with the
+  rest of the batch, so that the heads move between the drives once
+  per batch, not once per file. If it doesn't fit, the batch is 
+  written out to make room, and a file too big for the whole buffer 
+  is copied straight away. from and to must include the drive. 
+  Returns TRUE on success.
+
+===========================================================================*/
+BOOL cp_queue (from, to, d_flag)
+char *from;
+char *to;
+uint8_t d_flag;
+  {
+  riofile fin;
+  unsigned room, n;
+  cpfile *c;
+  ErrCode err;
+
+  if (strcmp (from, to) == 0)
+    {
+    fprintf (stderr, "%s: Source and destination are the same\r\n", to);
+    return FALSE;
+    }
+  if (cp_nbatch == CP_BATCH && !cp_flush (d_flag)) 
+    return FALSE;
+
+  err = rio_open (&fin, from);
+  if (err)
+    {
+    fprintf (stderr, "%s: %s\r\n", from, strerror (err));
+    return FALSE;
+    }
+
+  room = cp_nrecs - cp_used;
+  n = rio_read (&fin, cp_buf + cp_used * BD_SEC_SZ, room);
+  if (n == room && cp_used > 0)
+    {
+    /* It may not fit. Write the batch, move what was read to the 
+       start of the buffer, and fill the rest. */
+    unsigned at = cp_used;
+    if (!cp_flush (d_flag)) return FALSE;
+    memmove (cp_buf, cp_buf + at * BD_SEC_SZ, n * BD_SEC_SZ);
+    if (!fin.err)
+      n += rio_read (&fin, cp_buf + n * BD_SEC_SZ, cp_nrecs - n);
+    }
+  if (fin.err)
     {
-    fprintf (stderr, "%s: %s\r\n", fullfrom, strerror (errno));
+    fprintf (stderr, "%s: %s\r\n", from, strerror (fin.err));
     return FALSE;
     }
 
+  if (n == cp_nrecs)
+    {
+    cp_show (from, to, d_flag);
+    return cp_copy (&fin, 0, from, to, n, d_flag);
+    }
+
+  c = &cp_batch[cp_nbatch++];
+  strcpy (c->from, from);
+  strcpy (c->to, to);
+  c->start = cp_used;
+  c->nrecs = n;
+  cp_used += n;
   return TRUE;
   }
 
@@ -144,89 +615,214 @@ uint8_t d_flag;
 void cp_help ()
   {
   /* TODO */
-  printf ("Usage: cp [/v] [/p] {from...} {to} \r\n");
+  printf ("Usage: cp [/cdinruv] {from...} {to} \r\n");
   printf ("Copy a file to a file, or multiple files to a drive, or a drive\r\n");
   printf ("to a drive. For example: \"cp *.c b:\"\r\n");
   printf ("Options:\r\n");
   printf ("  /v  show files being copied\r\n");
-  printf ("  /d  show copy progress visually\r\n");
+  printf ("  /d  show copy progress as a percentage\r\n");
+  printf ("  /u  only copy files that are new or have changed size\r\n");
+  printf ("  /c  check each copy by reading it back\r\n");
+  printf ("  /r  resume an interrupted copy\r\n");
+  printf ("  /n  don't copy over existing files\r\n");
+  printf ("  /i  ask before copying over existing files\r\n");
   }
 
 /*===========================================================================
 
-  cp_expand
+  cp_one
 
-  on entry, 'thing' is a file and/or drive spec
+  Copy one file, found in a directory listing, to a drive. sd is the
+  source file's dirent. dest is the destination's list, if /u, /n or
+  /i needs it. Returns FALSE if the copy failed.
+
+  With /u, a file that is already there with the same size is 
+  skipped -- or, if /c is also given, with the same size and CRC. 
+  With /n, any file that is already there is skipped, and with /i the
+  user is asked. 
 
 ===========================================================================*/
-void cp_expand (thing, odrive, d_flag)
-char *thing;
+BOOL cp_one (fn, sd, odrive, dest, d_flag)
+char *fn;
+dirent *sd;
+Drive odrive;
+dirlist *dest;
 uint8_t d_flag;
-int odrive;
   {
-  dirent **dirs;
-  char *path = thing;
-  Drive drive = 0;
-  int colpos;
-
-  colpos = strchr (thing, ':'); 
-  if (colpos)
+  char fn2 [BD_MAX_PATH + 1];
+  dirent *d = 0;
+  fn2[0] = (odrive - 1) + 'A';
+  fn2[1] = ':';
+  strcpy (fn2 + 2, fn + 2);
+
+  if (dest)
+    d = dirs_find (dest, sd->name);
+  if (d && (d_flag & DF_UPD))
     {
-    if (colpos == thing + 1)
+    unsigned c1, c2;
+    if (d->recs == sd->recs && (!(d_flag & DF_CHK)
+        || (cp_crc_file (fn, &c1) == 0 && cp_crc_file (fn2, &c2) == 0 
+          && c1 == c2)))
       {
-      path = thing + 2;
-      drive = thing[0] - 'A' + 1;
-      if (drive < 1 || drive > 26)
-        {
-        fprintf (stderr, "\n%c: %s\n", thing[0], strerror (E_DLET));
-        return;
-        }
+      if (d_flag & DF_VERB)
+        printf ("%s: unchanged\r\n", fn2);
+      return TRUE;
       }
-    else
+    }
+  if (d && (d_flag & (DF_NOCL | DF_ASK)) && !cp_clobber (fn2, d_flag))
+    return TRUE;
+
+  /* A file that may be resumed can't be batched. It has already 
+     been looked for in the list. */
+  if (d_flag & DF_RES)
+    return cp_do_cp (fn, fn2, d_flag & ~(DF_NOCL | DF_ASK));
+  return cp_queue (fn, fn2, d_flag);
+  }
+
+/*===========================================================================
+
+  cp_dest
+
+  Read the destination directory once, into a list sorted by name, 
+  if /u, /n or /i needs it. This must be done before the copy buffer
+  is allocated, so that there is room for it. Returns FALSE if the
+  directory can't be read.
+
+===========================================================================*/
+BOOL cp_dest (odrive, dest, d_flag)
+Drive odrive;
+dirlist **dest;
+uint8_t d_flag;
+  {
+  *dest = 0;
+  if (d_flag & (DF_UPD | DF_NOCL | DF_ASK))
+    {
+    *dest = dirs_list (odrive, "*", DST_NAME | DST_SZ | DST_RAW);
+    if (!*dest)
       {
-      fprintf (stderr, "\n%s: %s\n", thing, strerror (E_FNAME));
-      return;
+      fprintf (stderr, "%c: %s\r\n", odrive - 1 + 'A', strerror (errno));
+      return FALSE;
       }
     }
+  return TRUE;
+  }
+
+/*===========================================================================
+
+  cp_expand
 
-  if (!path[0]) path = "*";
+  Copy the files matched by the n arguments in args to a drive. 
+  Small files are copied in batches. Stops at the first file that 
+  can't be copied, but the files read before it are still written;
+  the exit status is then non-zero. The source and destination directories are both read before the
+  copy buffer is allocated, so that there is room for them.
 
-  dirs = dirs_list (drive, path, 0); /* Don't sort or set sizes */
-  if (dirs)
+===========================================================================*/
+void cp_expand (n, args, odrive, d_flag)
+int n;
+char **args;
+Drive odrive;
+uint8_t d_flag;
+  {
+  char *fn;
+  BOOL ok = TRUE;
+  dirlist *dest;
+  exargs *ex;
+
+  if (!cp_dest (odrive, &dest, d_flag)) 
     {
-    BOOL match = FALSE;
-    int i = 0;
-    BOOL ok = TRUE;
-    while (dirs[i] && ok) 
-      {
-      char fn [BD_MAX_PATH + 1];
-      char fn2 [BD_MAX_PATH + 1];
-      Drive drive = dirs[i]->drive; 
-      if (dirs[i]->drive == 0)
-        drive = bd_cur_drv(); 
+    cp_status = -1;
+    return;
+    }
+  ex = ex_open (n, args, (d_flag & DF_UPD) ? DST_SZ : 0, 
+    EX_WARN | EX_SCAN);
+  if (!ex)
+    {
+    fprintf (stderr, "\n%s: %s\n", args[0], strerror (errno));
+    if (dest) dirs_free (dest);
+    cp_status = -1;
+    return;
+    }
+  cp_alloc ();
+
+  while (ok && !cp_stop && (fn = ex_next (ex))) 
+    ok = cp_one (fn, ex->d, odrive, dest, d_flag);
+  if (!cp_flush (d_flag)) ok = FALSE;
+  if ((!ok || cp_stop) && !cp_status) cp_status = -1;
+  ex_close (ex);
+  if (dest) dirs_free (dest);
+  }
 
-      fn[0] = (drive - 1) + 'A';
-      fn[1] = ':';
-      strcpy (fn + 2, dirs[i]->sname);
+/*===========================================================================
 
-      fn2[0] = (odrive - 1) + 'A';
-      fn2[1] = ':';
-      strcpy (fn2 + 2, dirs[i]->sname);
+  cp_drive
 
-      ok = cp_do_cp (fn, fn2, d_flag);
+  Copy every file on one drive to another. The files are copied in
+  order of where they start on the source disk, not by name, so that
+  its heads move mostly one way; if there isn't the memory to sort 
+  them that way, they are copied in name order, and the user is told.
+  At the end the amount copied is shown, with the rate if the BDOS 
+  has a clock. If the copy stopped early, that is said too. Either
+  way a failure gives a non-zero exit status.
 
-      match = TRUE;
-      i++;
-      }
-    dirs_free (dirs);
-    if (!match)
-      fprintf (stderr, "%s: no matching files\r\n", thing);
+===========================================================================*/
+void cp_drive (sdrive, odrive, d_flag)
+Drive sdrive;
+Drive odrive;
+uint8_t d_flag;
+  {
+  dirlist *list, *dest;
+  BOOL ok = TRUE;
+  ErrCode err;
+  long start, secs;
+  int i;
+
+  if (sdrive == odrive)
+    {
+    fprintf (stderr, "%c: Source and destination are the same\r\n", 
+      sdrive - 1 + 'A');
+    cp_status = -1;
+    return;
     }
-  else
+  list = dirs_list (sdrive, "*", DST_NAME | DST_SZ | DST_RAW);
+  if (!list)
+    {
+    fprintf (stderr, "%c: %s\r\n", sdrive - 1 + 'A', strerror (errno));
+    cp_status = -1;
+    return;
+    }
+  if ((err = dirs_by_block (list)))
+    fprintf (stderr, "%c: %s; copying in name order\r\n", 
+      sdrive - 1 + 'A', strerror (err));
+  if (!cp_dest (odrive, &dest, d_flag))
     {
-    fprintf (stderr, "\n%s: %s\n", thing, strerror (errno));
+    dirs_free (list);
+    cp_status = -1;
     return;
     }
+  cp_alloc ();
+
+  start = bd_secs ();
+  for (i = 0; ok && !cp_stop && i < list->n; i++)
+    {
+    char fn [BD_MAX_PATH + 1];
+    dirs_path (sdrive, &list->ents[i], fn);
+    ok = cp_one (fn, &list->ents[i], odrive, dest, d_flag);
+    }
+  if (!cp_flush (d_flag)) ok = FALSE;
+  if (dest) dirs_free (dest);
+  dirs_free (list);
+
+  if (!ok || cp_stop)
+    {
+    if (!cp_status) cp_status = -1;
+    printf ("Copy stopped: ");
+    }
+  printf ("%ld bytes copied", cp_copied * BD_SEC_SZ);
+  secs = start >= 0 ? bd_secs () - start : -1L;
+  if (secs > 0)
+    printf (" in %ld s, %ld records/s", secs, cp_copied / secs);
+  printf ("\r\n");
   }
 
 /*===========================================================================
@@ -238,12 +834,12 @@ int main (argc, argv)
 int argc;
 char **argv;
   {
-  int i, opt, myargs;
+  int opt, myargs;
   uint8_t d_flag = 0;
 
   argv[0] = "cp";
   
-  while ((opt = getopt (argc, argv, "HVD")) != -1)  
+  while ((opt = getopt (argc, argv, "HVDUCRNI")) != -1)  
     {
     switch (opt)
       {
@@ -252,6 +848,11 @@ char **argv;
         exit (0);
       case 'V': d_flag |= DF_VERB; break;
       case 'D': d_flag |= DF_PROG; break;
+      case 'U': d_flag |= DF_UPD; break;
+      case 'C': d_flag |= DF_CHK; break;
+      case 'R': d_flag |= DF_RES; break;
+      case 'N': d_flag |= DF_NOCL; break;
+      case 'I': d_flag |= DF_ASK; break;
       default: exit (-1); 
       }
     }
@@ -260,12 +861,15 @@ char **argv;
   if (myargs >= 2)
     {
     BOOL mult_src = FALSE;
+    char *arg1 = argv[optind];
+    /* Just a drive, as in "cp a: b:" */
+    BOOL whole = myargs == 2 && strlen (arg1) == 2 && arg1[1] == ':';
 
-    if (myargs > 2)
+    /* /u always copies to a drive, so go through cp_expand() */
+    if (myargs > 2 || whole || (d_flag & DF_UPD))
       mult_src = TRUE;
     else
       {
-      char *arg1 = argv[optind];
       if (strchr (arg1, '*') || strchr (arg1, '?'))
         mult_src = TRUE;
       }
@@ -276,12 +880,14 @@ char **argv;
       if (strlen (drvarg) == 2 && drvarg[1] == ':')
         {
         Drive drive = drvarg[0] - 'A' + 1;
-        if (drive > 0 && drive <= 26)
+        Drive sdrive = arg1[0] - 'A' + 1;
+        if (whole && sdrive > 0 && sdrive <= 26 && drive > 0 && drive <= 26)
           {
-          for (i = optind; i < argc - 1; i++)
-            {
-            cp_expand (argv[i], drive, d_flag);
-            }
+          cp_drive (sdrive, drive, d_flag);
+          }
+        else if (drive > 0 && drive <= 26)
+          {
+          cp_expand (argc - optind - 1, argv + optind, drive, d_flag);
           }
         else
           {
@@ -297,7 +903,11 @@ char **argv;
         }
       }
     else
-      cp_do_cp (argv[optind], argv[optind + 1], d_flag);
+      {
+      cp_alloc ();
+      if (!cp_do_cp (argv[optind], argv[optind + 1], d_flag) && !cp_status)
+        cp_status = -1;
+      }
     }
   else
     {
@@ -305,7 +915,7 @@ char **argv;
     exit (EINVAL); 
     }
 
-  return 0;
+  return cp_status;
   }
 
 
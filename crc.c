@@ -0,0 +1,54 @@
+/*===========================================================================
+
+  crc.c
+
+  Table-driven CRC-16/CCITT (polynomial 0x1021, most significant bit 
+  first). The table is built on first use, rather than compiled in, 
+  to keep it out of the .COM file. Each byte then costs one table 
+  lookup, instead of eight shifts.
+
+  Copyright (c)2021 Kevin Boone, GPL v3.0
+
+===========================================================================*/
+
+#include "defs.h"
+#include "crc.h"
+
+#define CRC_POLY 0x1021
+
+static unsigned crc_tab [256];
+static BOOL crc_ready = FALSE;
+
+/*===========================================================================
+
+  crc_init
+
+===========================================================================*/
+static void crc_init ()
+  {
+  unsigned i, j, c;
+  for (i = 0; i < 256; i++)
+    {
+    c = i << 8;
+    for (j = 0; j < 8; j++)
+      c = (c & 0x8000) ? (c << 1) ^ CRC_POLY : c << 1;
+    crc_tab[i] = c & 0xFFFF;
+    }
+  crc_ready = TRUE;
+  }
+
+/*===========================================================================
+
+  crc_update
+
+===========================================================================*/
+unsigned crc_update (crc, buf, len)
+unsigned crc;
+uint8_t *buf;
+unsigned len;
+  {
+  if (!crc_ready) crc_init ();
+  while (len--)
+    crc = ((crc << 8) ^ crc_tab[((crc >> 8) ^ *buf++) & 0xFF]) & 0xFFFF;
+  return crc;
+  }
@@ -0,0 +1,22 @@
+/*===========================================================================
+
+  crc.h
+
+  CRC-16/CCITT, as used by XModem-CRC, but starting from 0xFFFF.
+
+  Copyright (c)2021 Kevin Boone, GPL v3.0
+
+===========================================================================*/
+#ifndef __CRC_H
+#define __CRC_H
+
+#include "defs.h"
+
+/* The CRC of nothing; pass this to the first crc_update() */
+#define CRC_INIT 0xFFFF
+
+/** Add len bytes at buf to a CRC. Args: unsigned crc, uint8_t *buf,
+    unsigned len. Returns the new CRC. */
+extern unsigned crc_update ();
+
+#endif /* crc.h */
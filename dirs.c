@@ -15,38 +15,14 @@
 #include "compat.h"
 #include "dirs.h"
 
-/*===========================================================================
-
-  count_dir 
-
-  Count the number of entries in the specified drive's directory.
+static void sort_dirs ();
 
-  drive -- A=1, B=2...
-
-  Returns zero on success
+/* Number of BDOS search calls, or BIOS sector reads, made by the last 
+   dirs_list() */
+int dirs_ncalls = 0;
 
-===========================================================================*/
-static ErrCode count_dir (drive, total)
-Drive drive;
-int *total;
-  {
-  int n;
-  char *fcb = FCB; 
-  fcb[0] = drive;
-  *total = 0;
-  strcpy (fcb + 1, "???????????");
-
-  if ((n = bdos (BDOS_DFIRST, FCB)) == 255) return E_EDIR; 
-    {
-    do
-      {
-      char *fcbbuf = DMABUF + 32*n;
-      (*total)++;
-      } while ((n=bdos (BDOS_DNEXT, FCB)) != 255);  
-    }
-
-  return 0;
-  }
+/* Size of the block allocated by the last dirs_list() */
+unsigned dirs_nbytes = 0;
 
 /*===========================================================================
 
@@ -86,61 +62,467 @@ char *name;
     }
   }
 
+/*===========================================================================
+
+  dirs_sname
+
+===========================================================================*/
+char *dirs_sname (d, buf)
+dirent *d;
+char *buf;
+  {
+  memcpy (buf, d->name, BD_MAX_FNAME);
+  buf[BD_MAX_FNAME] = 0;
+  san_fname (buf);
+  return buf;
+  }
+
+/*===========================================================================
+
+  dirs_path
+
+===========================================================================*/
+char *dirs_path (drive, d, buf)
+Drive drive;
+dirent *d;
+char *buf;
+  {
+  buf[0] = (drive - 1) + 'A';
+  buf[1] = ':';
+  dirs_sname (d, buf + 2);
+  return buf;
+  }
+
+/*===========================================================================
+
+  add_ent
+
+  Merge the size given by one of a file's directory entries into its
+  dirent. The size is worked out from the entry's extent and 
+  record-count bytes; the entry with the highest extent gives the
+  size of the file. If the record count makes no sense, the size is
+  marked unknown, and that sticks, so that size_dirs() will ask the 
+  BDOS instead.
+
+===========================================================================*/
+static void add_ent (d, fcbbuf)
+dirent *d;
+uint8_t *fcbbuf;
+  {
+  long recs;
+  if (d->attr & DA_NOSZ) return;
+  if (fcbbuf[DE_RC] > BD_EXT_RECS) 
+    {
+    d->attr |= DA_NOSZ;
+    return;
+    }
+  recs = (long)((fcbbuf[DE_S2] & 0x3F) * BD_S2_EXTS 
+     + (fcbbuf[DE_EX] & 0x1F)) * BD_EXT_RECS + fcbbuf[DE_RC];
+  if (recs > DIRS_MAX_RECS) recs = DIRS_MAX_RECS;
+  if ((unsigned)recs > d->recs) d->recs = (unsigned)recs;
+  }
+
+/*===========================================================================
+
+  same_name
+
+  Returns TRUE if the directory entry in fcbbuf has the same name and
+  user number as the dirent, ignoring attribute bits.
+
+===========================================================================*/
+static BOOL same_name (fcbbuf, d)
+char *fcbbuf;
+dirent *d;
+  {
+  register int i;
+  if (fcbbuf[0] != DIRS_USER (d)) return FALSE;
+  for (i = 0; i < BD_MAX_FNAME; i++)
+    if ((fcbbuf[1 + i] & CHAR_MASK) != d->name[i]) return FALSE;
+  return TRUE;
+  }
+
+/*===========================================================================
+
+  cmp_key
+
+  Compare two fixed-length, space-padded FCB name fields. 
+
+===========================================================================*/
+static int cmp_key (k1, k2, len)
+register char *k1;
+register char *k2;
+int len;
+  {
+  while (len--)
+    {
+    if (*k1 != *k2) return *k1 - *k2;
+    k1++; k2++;
+    }
+  return 0;
+  }
+
+/*===========================================================================
+
+  merge_dirs
+
+  Collapse runs of dirents with the same name and user -- the extents
+  of one file -- into a single dirent. The list must be sorted by 
+  name.
+
+===========================================================================*/
+static void merge_dirs (list)
+dirlist *list;
+  {
+  dirent *d = list->ents;
+  int i, j = 0;
+  for (i = 0; i < list->n; i++)
+    {
+    if (j > 0 && cmp_key (d[j - 1].name, d[i].name, BD_MAX_FNAME) == 0
+        && DIRS_USER (&d[j - 1]) == DIRS_USER (&d[i]))
+      {
+      d[j - 1].attr |= d[i].attr & DA_NOSZ;
+      if (d[i].recs > d[j - 1].recs) 
+        d[j - 1].recs = d[i].recs;
+      }
+    else
+      {
+      if (j != i) 
+        memcpy (&d[j], &d[i], sizeof (dirent));
+      j++;
+      }
+    }
+  list->n = j;
+  }
+
+/*===========================================================================
+
+  dirs_match
+
+  Test a dirent's name against a pattern: the compiled pattern, if
+  there is one, or else the FCB mask from mt_mask().
+
+===========================================================================*/
+BOOL dirs_match (d, mask, mt)
+dirent *d;
+char *mask;
+mtpat *mt;
+  {
+  if (mt)
+    return mt_name (mt, d->name);
+  return mt_fcb (mask, d->name);
+  }
+
+/*===========================================================================
+
+  ent_init
+
+  Fill in a dirent from a file's directory entry.
+
+===========================================================================*/
+static void ent_init (d, fcbbuf)
+dirent *d;
+char *fcbbuf;
+  {
+  int i;
+  for (i = 0; i < BD_MAX_FNAME; i++)
+    d->name[i] = fcbbuf[1 + i] & CHAR_MASK;
+  d->attr = (fcbbuf[0] << 4) & DA_USER;
+  if (fcbbuf[9] & ATTR_MASK) d->attr |= DA_RO; 
+  if (fcbbuf[10] & ATTR_MASK) d->attr |= DA_SYS; 
+  if (fcbbuf[11] & ATTR_MASK) d->attr |= DA_ARC; 
+  d->recs = 0;
+  add_ent (d, fcbbuf);
+  }
+
+/*===========================================================================
+
+  ent_want
+
+  Decide whether a directory entry is a file that the caller wants.
+  When the search was for all user areas, or the directory was read
+  through the BIOS, nothing has matched the mask yet (by_bdos is 
+  FALSE), so it has to be done here. If the pattern couldn't be a 
+  mask, mt is the compiled pattern.
+
+  user -- the user area wanted, or -1 for all of them
+
+===========================================================================*/
+static BOOL ent_want (fcbbuf, mask, mt, by_bdos, user)
+uint8_t *fcbbuf;
+char *mask;
+mtpat *mt;
+BOOL by_bdos;
+int user;
+  {
+  /* With a drive in the FCB the BDOS should only return live entries
+     in the current user area, but don't count on it. */
+  if (user < 0)
+    {
+    if (fcbbuf[0] > BD_MAX_USER) return FALSE;
+    }
+  else if (fcbbuf[0] != user) 
+    return FALSE;
+  if (mt)
+    return mt_name (mt, fcbbuf + 1);
+  return by_bdos || mt_fcb (mask, fcbbuf + 1);
+  }
+
+/*===========================================================================
+
+  set_fcb
+
+  Set up a search FCB. With DST_ALLU, the drive byte is '?', which
+  makes the BDOS return every entry on the current drive, in every
+  user area; the drive must be selected before searching. Otherwise
+  the mask, if there is one, does the matching.
+
+===========================================================================*/
+static void set_fcb (fcb, drive, mask, masked, allu)
+char *fcb;
+Drive drive;
+char *mask;
+BOOL masked;
+BOOL allu;
+  {
+  memset (fcb, 0, 36);
+  if (allu)
+    fcb[0] = '?';
+  else
+    fcb[0] = drive;
+  if (masked)
+    memcpy (fcb + 1, mask, BD_MAX_FNAME);
+  else
+    memset (fcb + 1, '?', BD_MAX_FNAME); 
+  }
+
+/*===========================================================================
+
+  raw_open
+
+  Get ready to read the directory of the currently-selected drive
+  directly through the BIOS, a sector at a time, rather than one
+  entry per BDOS call. This is only tried on CP/M 2.2, where the BIOS
+  always deals in 128-byte records, and the position of the directory
+  follows from the DPB: it fills the first (DRM + 1) / 4 records
+  after the reserved tracks. Returns FALSE if the drive can't be read
+  this way, and the BDOS should be used.
+
+===========================================================================*/
+static uint8_t *raw_xlt;  /* Sector translation table, or 0 */
+static unsigned raw_spt;  /* Records per track */
+static unsigned raw_trk;  /* Track being read */
+static unsigned raw_sec;  /* Next logical record on the track */
+static unsigned raw_left; /* Directory records still to read */
+static int raw_idx;       /* Next entry in the record, 0-3 */
+static BOOL raw_on;       /* Reading through the BIOS */
+static BOOL raw_err;      /* The BIOS reported a read error */
+
+static BOOL raw_open (drive)
+Drive drive;
+  {
+  uint8_t *dph, *dpb;
+  if (bd_ver () != 0x22) return FALSE;
+  /* The BDOS has already logged in the drive, so this just returns
+     its DPH, or zero if there is no such drive. */
+  dph = (uint8_t *)biosh (BIOS_SELDSK, drive - 1, 1);
+  if (!dph) return FALSE;
+  dpb = bd_dpb ();
+  raw_xlt = (uint8_t *)BD_WORD (dph + DPH_XLT);
+  raw_spt = BD_WORD (dpb + DPB_SPT);
+  raw_trk = BD_WORD (dpb + DPB_OFF);
+  raw_left = BD_WORD (dpb + DPB_DRM) / 4 + 1;
+  raw_sec = 0;
+  raw_idx = 4;
+  raw_err = FALSE;
+  return raw_spt != 0;
+  }
+
+/*===========================================================================
+
+  raw_read
+
+  Read the next directory record into the default DMA buffer. Returns 
+  FALSE at the end of the directory, or if the read failed.
+
+===========================================================================*/
+static BOOL raw_read ()
+  {
+  unsigned psec;
+  if (raw_left == 0) return FALSE;
+  if (raw_sec == raw_spt)
+    {
+    raw_sec = 0;
+    raw_trk++;
+    }
+  psec = biosh (BIOS_SECTRAN, raw_sec, raw_xlt);
+  bios (BIOS_SETTRK, raw_trk, 0);
+  bios (BIOS_SETSEC, psec, 0);
+  bios (BIOS_SETDMA, DMABUF, 0);
+  raw_sec++;
+  raw_left--;
+  dirs_ncalls++;
+  if (bios (BIOS_READ, 0, 0) != 0)
+    {
+    raw_err = TRUE;
+    return FALSE;
+    }
+  return TRUE;
+  }
+
+/*===========================================================================
+
+  dir_ent
+
+  Get the first or next directory entry, from the BDOS search on FCB 
+  or, if raw_on is set, from the BIOS four at a time. Returns 0 when
+  there are no more.
+
+===========================================================================*/
+static uint8_t *dir_ent (first)
+BOOL first;
+  {
+  int n;
+  if (raw_on)
+    {
+    if (raw_idx == 4)
+      {
+      if (!raw_read ()) return 0;
+      raw_idx = 0;
+      }
+    return DMABUF + 32 * raw_idx++;
+    }
+  n = bdos (first ? BDOS_DFIRST : BDOS_DNEXT, FCB);
+  dirs_ncalls++;
+  return n == 255 ? 0 : DMABUF + 32 * n;
+  }
+
 /*===========================================================================
 
   fill_dirs 
 
+  Enumerate the directory in a single pass. Matching entries are 
+  collected in a dirlist with room for as many files as the directory
+  has entries (DRM + 1, from the DPB); at the end it is trimmed to
+  size, so the whole list is one block, freed with a single call. 
+  Growing the list as it filled would need the old and new blocks at
+  once, and so more memory at the peak than the largest list. The BDOS is called exactly once for each 
+  directory entry, plus once more for the search that finds nothing.
+
+  The search returns every extent of every file. Extents are merged
+  into one dirent per file: usually a file's extents are adjacent in
+  the directory, and merge with the previous dirent as they are read.
+  If a later extent turns up on its own, the list is sorted and 
+  merged at the end. Deleted entries, and entries that belong to 
+  other user areas, are skipped. 
+
+  Where the pattern can be written as an FCB mask, the BDOS only
+  returns matching entries; otherwise every entry is returned, and
+  is tested with the compiled pattern. With DST_ALLU, one search covers every
+  user area, and the matching is all done here. With DST_RAW, the 
+  directory sectors are read through the BIOS if raw_open() allows 
+  it, and matched here too; if a read fails, the scan is done again
+  with the BDOS.
+
   drive -- A=1, B=2...
 
   Returns zero on success
 
 ===========================================================================*/
-static ErrCode fill_dirs (drive, max, dirents, pattern)
+static ErrCode fill_dirs (drive, result, pattern, flags)
 Drive drive;
-int max;
+dirlist **result;
 char *pattern;
-dirent *dirents[];
+uint8_t flags;
   {
-  int i, n;
-  int count = 0;
+  unsigned max;
+  int user = bd_cur_usr ();
+  Drive old_drive = bd_cur_drv ();
+  BOOL scattered = FALSE;
+  BOOL allu = (flags & DST_ALLU) != 0;
+  BOOL sel;
+  BOOL masked;
+  char mask [BD_MAX_FNAME];
+  mtpat mt;
+  dirlist *list;
+  uint8_t *fcbbuf;
   char *fcb = FCB; 
-  fcb[0] = drive;
-  strcpy (fcb + 1, "???????????"); 
 
-  if ((n = bdos (BDOS_DFIRST, FCB)) == 255) return E_EDIR; 
+  masked = mt_mask (pattern, mask);
+  if (!masked) mt_compile (pattern, &mt);
+  set_fcb (fcb, drive, mask, masked, allu);
+  /* Match every extent, not just the first entry of each file. */
+  fcb[DE_EX] = '?';
+  fcb[DE_S2] = '?';
+
+  dirs_ncalls = 0;
+  dirs_nbytes = 0;
+
+  /* Searching all user areas, and reading the DPB, both work on the
+     current drive. */
+  if (!drive) drive = old_drive;
+  sel = drive != old_drive;
+  if (sel) bd_sel_drv (drive);
+  max = BD_WORD (bd_dpb () + DPB_DRM) + 1;
+
+  list = malloc (DIRS_BYTES (max));
+  if (!list) 
     {
-    do
+    if (sel) bd_sel_drv (old_drive);
+    return ENOMEM;
+    }
+  list->drive = drive;
+  list->n = 0;
+
+  raw_on = (flags & DST_RAW) && raw_open (list->drive);
+  if (allu) user = -1;
+
+  /* The search results land in the DMA buffer, which file I/O may
+     have moved. A search that finds nothing is not an error; the list
+     is just empty. */
+  bdos (BDOS_SETDMA, DMABUF);
+  for (fcbbuf = dir_ent (TRUE); fcbbuf; fcbbuf = dir_ent (FALSE))
+    {
+    if (list->n > 0 && same_name (fcbbuf, &list->ents[list->n - 1]))
       {
-      int ret;
-      char *fcbbuf = DMABUF + 32 * n;
-      char temp_name [BD_MAX_FNAME + 1]; 
-      char temp_sname [BD_MAX_DFNAME + 1]; 
+      add_ent (&list->ents[list->n - 1], fcbbuf);
+      continue;
+      }
 
-      for (i = 0; i < 11; i++)
-        {
-        temp_name[i] = fcbbuf[1 + i] & CHAR_MASK;
-        }
-      temp_name[BD_MAX_FNAME] = 0;
-      strcpy (temp_sname, temp_name);
-      san_fname (temp_sname);
-      
-      ret = fnmatch (pattern, temp_sname, FNM_CASEFOLD);
-      if (ret == 0)
-        {
-        dirents[count] = malloc (sizeof (dirent));
+    if (ent_want (fcbbuf, mask, masked ? 0 : &mt, !allu && !raw_on, 
+          user))
+      {
+      /* Only a corrupt directory could overflow the list */
+      if (list->n == max) break;
+      ent_init (&list->ents[list->n], fcbbuf);
+      if (fcbbuf[DE_EX] || fcbbuf[DE_S2])
+        scattered = TRUE;
+      list->n++;
+      }
+    }
 
-        strcpy (dirents[count]->name, temp_name);
-        strcpy (dirents[count]->sname, temp_sname);
+  /* The BDOS selects the drive again, and sets its own DMA address,
+     before it next reads the disk, so the BIOS needs no tidying. */
+  if (sel) bd_sel_drv (old_drive);
 
-        dirents[count]->drive = drive;
-        dirents[count]->ro = fcbbuf[9] & ATTR_MASK; 
-        dirents[count]->sys = fcbbuf[9] & ATTR_MASK;
-        count++;
-        }
-      } while ((n=bdos (BDOS_DNEXT, FCB)) != 255 && count < max);  
+  if (raw_on && raw_err)
+    {
+    free (list);
+    return fill_dirs (drive, result, pattern, flags & ~DST_RAW);
     }
  
-  dirents[count] = 0;
+  /* An entry with a non-zero extent number that did not follow
+     another extent of the same file may be a stray, so merge the hard
+     way. */
+  if (scattered)
+    {
+    sort_dirs (list, DST_NAME);
+    merge_dirs (list);
+    }
+
+  /* Give back the unused part of the block. */
+  dirs_nbytes = DIRS_BYTES (list->n);
+  *result = realloc (list, dirs_nbytes);
+  if (!*result) *result = list;
 
   return 0;
   }
@@ -150,31 +532,51 @@ dirent *dirents[];
 
   size_dirs
 
+  Fill in the sizes that fill_dirs() could not get from the directory
+  entries, by opening the file and asking the BDOS. Each of these 
+  calls searches the directory again, so this is only a fallback.
+
 ===========================================================================*/
-static void size_dirs (dirents)
-dirent *dirents[];
+static void size_ent (drive, d)
+Drive drive;
+dirent *d;
   {
-  int i = 0;
-  while (dirents[i])
+  uint8_t _fcb[36];
+  int user = bd_cur_usr ();
+  /* A file from another user area can only be opened from there. */
+  if (DIRS_USER (d) != user) 
+    bdos (BDOS_USER, DIRS_USER (d));
+  memset (_fcb, 0, sizeof (_fcb));
+  _fcb[0] = drive;
+  memcpy (_fcb + 1, d->name, BD_MAX_FNAME);
+  if (bdos (BDOS_OPEN, _fcb) == 0)
     {
-    uint8_t _fcb[36];
-    memset (_fcb, 0, sizeof (_fcb));
-    _fcb[0] = dirents[i]->drive;
-    memcpy (_fcb + 1, dirents[i]->name, BD_MAX_FNAME);
-    if (bdos (BDOS_OPEN, _fcb) == 0)
-      {
-      bdos (BDOS_FSIZE, _fcb);
-      dirents[i]->recs = _fcb[33] + 256 * _fcb[34];
-      }
-    else
-      {
-      /* Some files don't seem to open, even though they have
-         directory entries. Lacking any other information, say
-         they are one record. */
-      dirents[i]->recs = 1;
-      }
-    bdos (BDOS_CLOSE, _fcb);
-    i++;
+    bdos (BDOS_FSIZE, _fcb);
+    /* r2 is only set for a file of 65536 records */
+    d->recs = _fcb[35] ? DIRS_MAX_RECS : _fcb[33] + 256 * _fcb[34];
+    }
+  else
+    {
+    /* Some files don't seem to open, even though they have
+       directory entries. Lacking any other information, say
+       they are one record. */
+    d->recs = 1;
+    }
+  d->attr &= ~DA_NOSZ;
+  bdos (BDOS_CLOSE, _fcb);
+  if (DIRS_USER (d) != user) 
+    bdos (BDOS_USER, user);
+  }
+
+static void size_dirs (list)
+dirlist *list;
+  {
+  int i;
+  for (i = 0; i < list->n; i++)
+    {
+    dirent *d = &list->ents[i];
+    if (d->attr & DA_NOSZ) 
+      size_ent (list->drive, d);
     }
   }
 
@@ -182,73 +584,100 @@ dirent *dirents[];
 
   free_dirs 
 
+  The list and its entries are all one block.
+
 ===========================================================================*/
-void dirs_free (dirents)
-dirent *dirents[];
+void dirs_free (list)
+dirlist *list;
   {
-  int i = 0;
-  while (dirents[i])
-    {
-    free (dirents[i]);
-    i++;
-    }
-  free (dirents);
+  free (list);
+  }
+
+/*===========================================================================
+
+  cmp_dirs
+
+  Compare two dirents according to the DST_* flags. Size order puts
+  the largest file first; ties are broken by extension (if DST_EXT)
+  and then by name, then by user. DST_DSC reverses the whole order.
+
+===========================================================================*/
+static int cmp_dirs (d1, d2, flags)
+dirent *d1;
+dirent *d2;
+uint8_t flags;
+  {
+  int r = 0;
+  if ((flags & DST_SIZE) && d1->recs != d2->recs)
+    r = d1->recs > d2->recs ? -1 : 1;
+  if (r == 0 && (flags & DST_EXT))
+    r = cmp_key (d1->name + 8, d2->name + 8, 3);
+  if (r == 0)
+    r = cmp_key (d1->name, d2->name, BD_MAX_FNAME);
+  if (r == 0)
+    r = DIRS_USER (d1) - DIRS_USER (d2);
+  if (flags & DST_DSC)
+    r = -r;
+  return r;
   }
 
 /*===========================================================================
 
-  dirs_len 
+  sift_dirs
+
+  Move d[root] down the heap of n elements until both its children
+  compare lower.
 
 ===========================================================================*/
-int dirs_len (dirents)
-dirent *dirents[];
+static void sift_dirs (d, root, n, flags)
+dirent *d;
+int root;
+int n;
+uint8_t flags;
   {
-  int i = 0;
-  while (dirents[i]) { i++; }
-  return i;
+  dirent t;
+  int child;
+  memcpy (&t, &d[root], sizeof (dirent));
+  while ((child = 2 * root + 1) < n)
+    {
+    if (child + 1 < n && cmp_dirs (&d[child], &d[child + 1], flags) < 0)
+      child++;
+    if (cmp_dirs (&t, &d[child], flags) >= 0) 
+      break;
+    memcpy (&d[root], &d[child], sizeof (dirent));
+    root = child;
+    }
+  memcpy (&d[root], &t, sizeof (dirent));
   }
 
 /*===========================================================================
 
   sort_dirs 
 
+  Heapsort the list in place. This needs no memory beyond the list
+  itself, and O(n log n) comparisons even on a full directory.
+
 ===========================================================================*/
-static void sort_dirs (d, flags)
-dirent *d[];
+static void sort_dirs (list, flags)
+dirlist *list;
 uint8_t flags;
   {
-  int n;
-  int i, j;
+  dirent *d = list->ents;
+  dirent t;
+  int n = list->n;
+  int i;
 
-  if (!(flags & (DST_NAME | DST_SIZE)))
+  if (!(flags & (DST_NAME | DST_SIZE | DST_EXT)))
     return;
 
-  n = dirs_len (d);
-  for (j = 0; j < n; j++)
+  for (i = n / 2 - 1; i >= 0; i--)
+    sift_dirs (d, i, n, flags);
+  for (i = n - 1; i > 0; i--)
     {
-    for (i = j; i < n; i++)
-      {
-      if (flags & DST_SIZE)
-        {
-        if (d[i]->recs > d[j]->recs)
-          {
-          dirent *t = d[i];
-          d[i] = d[j];
-          d[j] = t;
-          }
-	}
-      else
-        {
-        char *n1 = d[i]->name;
-        char *n2 = d[j]->name;
-        if (strcmp (n1, n2) < 0)
-          {
-          dirent *t = d[i];
-          d[i] = d[j];
-          d[j] = t;
-          }
-	}
-      }
+    memcpy (&t, &d[0], sizeof (dirent));
+    memcpy (&d[0], &d[i], sizeof (dirent));
+    memcpy (&d[i], &t, sizeof (dirent));
+    sift_dirs (d, 0, i, flags);
     }
   }
 
@@ -257,31 +686,349 @@ uint8_t flags;
   dirs_list
 
 ===========================================================================*/
-dirent **dirs_list (drive, pattern, flags)
+dirlist *dirs_list (drive, pattern, flags)
 Drive drive;
 char *pattern;
 uint8_t flags;
   {
-  int n;
-  dirent **d = 0; 
-  errno = count_dir (drive, &n);
+  dirlist *list = 0; 
+  errno = fill_dirs (drive, &list, pattern, flags);
   if (errno == 0)
     {
-    int i;
-    d = malloc ((n + 1) * sizeof (dirent *));
-    if (d)
+    if (flags & DST_SZ)
+      size_dirs (list);
+    if (flags & 0x0F)
+      sort_dirs (list, flags); 
+    }
+  return list;
+  }
+
+/*===========================================================================
+
+  dirs_find
+
+===========================================================================*/
+dirent *dirs_find (list, name)
+dirlist *list;
+char *name;
+  {
+  int lo = 0, hi = list->n;
+  while (lo < hi)
+    {
+    int mid = lo + (hi - lo) / 2;
+    int r = cmp_key (list->ents[mid].name, name, BD_MAX_FNAME);
+    if (r == 0) return &list->ents[mid];
+    if (r < 0)
+      lo = mid + 1;
+    else
+      hi = mid;
+    }
+  return 0;
+  }
+
+/*===========================================================================
+
+  dirs_by_block
+
+  Each directory entry lists the file's allocation blocks in bytes 16
+  to 31: sixteen of them, as bytes, if the drive has fewer than 256 
+  blocks, or eight words otherwise. Zero means no block. A second 
+  pass over the directory finds the lowest block of each file, by 
+  looking its name up in the list, and then the list is heapsorted 
+  on that, with the blocks carried along in a parallel array.
+
+===========================================================================*/
+static void swap_blk (d, blk, i, j)
+dirent *d;
+unsigned *blk;
+int i;
+int j;
+  {
+  dirent t;
+  unsigned b;
+  memcpy (&t, &d[i], sizeof (dirent));
+  memcpy (&d[i], &d[j], sizeof (dirent));
+  memcpy (&d[j], &t, sizeof (dirent));
+  b = blk[i]; blk[i] = blk[j]; blk[j] = b;
+  }
+
+static void sift_blk (d, blk, root, n)
+dirent *d;
+unsigned *blk;
+int root;
+int n;
+  {
+  int child;
+  while ((child = 2 * root + 1) < n)
+    {
+    if (child + 1 < n && blk[child] < blk[child + 1])
+      child++;
+    if (blk[root] >= blk[child]) 
+      break;
+    swap_blk (d, blk, root, child);
+    root = child;
+    }
+  }
+
+ErrCode dirs_by_block (list)
+dirlist *list;
+  {
+  unsigned *blk;
+  Drive old_drive = bd_cur_drv ();
+  int user = bd_cur_usr ();
+  BOOL wide;
+  char name [BD_MAX_FNAME];
+  char *fcb = FCB;
+  uint8_t *e;
+  int i;
+
+  if (list->n == 0) return 0;
+  blk = malloc (list->n * sizeof (unsigned));
+  if (!blk) return ENOMEM;
+  for (i = 0; i < list->n; i++)
+    blk[i] = 0xFFFF;
+
+  /* The DPB is the current drive's */
+  if (list->drive != old_drive) bd_sel_drv (list->drive);
+  wide = BD_WORD (bd_dpb () + DPB_DSM) > 255;
+
+  set_fcb (fcb, list->drive, 0, FALSE, FALSE);
+  fcb[DE_EX] = '?';
+  fcb[DE_S2] = '?';
+  raw_on = FALSE;
+  bdos (BDOS_SETDMA, DMABUF);
+  for (e = dir_ent (TRUE); e; e = dir_ent (FALSE))
+    {
+    dirent *d;
+    if (e[0] != user) continue;
+    for (i = 0; i < BD_MAX_FNAME; i++)
+      name[i] = e[1 + i] & CHAR_MASK;
+    d = dirs_find (list, name);
+    if (!d) continue;
+    for (i = 0; i < 16; i += wide ? 2 : 1)
       {
-      d[0] = 0;
-      fill_dirs (drive, n, d, pattern);
-      if (flags & DST_SZ)
-        size_dirs (d);
-      if (flags & 0x0F)
-        sort_dirs (d, flags); 
+      unsigned b = wide ? BD_WORD (e + 16 + i) : e[16 + i];
+      if (b != 0 && b < blk[d - list->ents]) 
+        blk[d - list->ents] = b;
       }
-    else
+    }
+  if (list->drive != old_drive) bd_sel_drv (old_drive);
+
+  for (i = list->n / 2 - 1; i >= 0; i--)
+    sift_blk (list->ents, blk, i, list->n);
+  for (i = list->n - 1; i > 0; i--)
+    {
+    swap_blk (list->ents, blk, 0, i);
+    sift_blk (list->ents, blk, 0, i);
+    }
+  free (blk);
+  return 0;
+  }
+
+/*===========================================================================
+
+  dirs_sum
+
+  Every directory entry in user areas 0-15 goes into the checksum: 
+  its user number, name and attributes, extent bytes and record 
+  count. Deleted entries, and the date stamps of CP/M 3, are left 
+  out, since they change without the files changing. So are files in
+  the current user area whose names are in skip. If a BIOS read
+  fails, the directory is read again through the BDOS.
+
+===========================================================================*/
+static BOOL sum_skip (e, skip, user)
+uint8_t *e;
+char **skip;
+int user;
+  {
+  int i;
+  if (!skip || e[0] != user) return FALSE;
+  for (; *skip; skip++)
+    {
+    for (i = 0; i < BD_MAX_FNAME; i++)
+      if ((e[1 + i] & CHAR_MASK) != (*skip)[i]) break;
+    if (i == BD_MAX_FNAME) return TRUE;
+    }
+  return FALSE;
+  }
+
+unsigned dirs_sum (drive, skip)
+Drive drive;
+char **skip;
+  {
+  Drive old_drive = bd_cur_drv ();
+  int user = bd_cur_usr ();
+  BOOL raw = TRUE;
+  unsigned sum;
+  char *fcb = FCB;
+  uint8_t *e;
+  int i;
+
+  /* The search of all user areas, and the BIOS read, both work on 
+     the current drive */
+  if (drive != old_drive) bd_sel_drv (drive);
+  do
+    {
+    sum = 0;
+    raw_on = raw && raw_open (drive);
+    set_fcb (fcb, drive, 0, FALSE, TRUE);
+    fcb[DE_EX] = '?';
+    fcb[DE_S2] = '?';
+    bdos (BDOS_SETDMA, DMABUF);
+    for (e = dir_ent (TRUE); e; e = dir_ent (FALSE))
+      {
+      if (e[0] > BD_MAX_USER || sum_skip (e, skip, user)) continue;
+      for (i = 0; i <= DE_RC; i++)
+        sum = ((sum << 1) | (sum >> 15)) + e[i];
+      }
+    raw = FALSE;
+    } while (raw_on && raw_err);
+  if (drive != old_drive) bd_sel_drv (old_drive);
+  return sum;
+  }
+
+/*===========================================================================
+
+  dirs_open
+
+===========================================================================*/
+dircur *dirs_open (drive, pattern, flags)
+Drive drive;
+char *pattern;
+uint8_t flags;
+  {
+  dircur *cur = malloc (sizeof (dircur));
+  if (!cur)
+    {
+    errno = ENOMEM;
+    return 0;
+    }
+  memset (cur, 0, sizeof (dircur));
+  cur->old_drive = bd_cur_drv ();
+  cur->drive = drive ? drive : cur->old_drive;
+  cur->flags = flags;
+  cur->user = bd_cur_usr ();
+  cur->allu = (flags & DST_ALLU) != 0;
+  if (!mt_mask (pattern, cur->mask))
+    {
+    cur->mt = malloc (sizeof (mtpat));
+    if (!cur->mt)
+      {
+      free (cur);
       errno = ENOMEM;
+      return 0;
+      }
+    mt_compile (pattern, cur->mt);
+    }
+  set_fcb (cur->fcb, drive, cur->mask, !cur->mt, cur->allu);
+  /* The extent and S2 bytes stay zero, so the BDOS returns only the
+     first directory entry of each file -- except that a search of 
+     all user areas returns everything, and the extent mask is needed
+     to spot first entries. */
+  if (cur->allu)
+    {
+    if (cur->drive != cur->old_drive) bd_sel_drv (cur->drive);
+    cur->exm = bd_dpb ()[DPB_EXM];
+    if (cur->drive != cur->old_drive) bd_sel_drv (cur->old_drive);
+    }
+  errno = 0;
+  return cur;
+  }
+
+/*===========================================================================
+
+  fill_cur
+
+  Read the next batch of matching files into the cursor's buffer.
+  Unless the search is known to be intact, start it again and skip
+  the entries that have already been seen. Sizes that can't be read
+  from the first directory entry are fixed up last, because they
+  need file operations that spoil the search.
+
+===========================================================================*/
+static void fill_cur (cur)
+dircur *cur;
+  {
+  int i, n;
+
+  cur->nbuf = 0;
+  cur->next = 0;
+  if (cur->done) return;
+
+  if (cur->allu && cur->drive != cur->old_drive) 
+    bd_sel_drv (cur->drive);
+  bdos (BDOS_SETDMA, DMABUF);
+  if (cur->live)
+    n = bdos (BDOS_DNEXT, cur->fcb);
+  else
+    {
+    n = bdos (BDOS_DFIRST, cur->fcb);
+    for (i = 0; i < cur->seen && n != 255; i++)
+      n = bdos (BDOS_DNEXT, cur->fcb);
+    }
+
+  while (n != 255)
+    {
+    uint8_t *fcbbuf = DMABUF + 32 * n;
+    cur->seen++;
+    if ((!cur->allu || ((fcbbuf[DE_EX] & ~cur->exm) == 0 && !fcbbuf[DE_S2]))
+        && ent_want (fcbbuf, cur->mask, cur->mt, 
+           !cur->allu, cur->allu ? -1 : cur->user))
+      {
+      dirent *d = &cur->buf[cur->nbuf++];
+      ent_init (d, fcbbuf);
+      /* This is the file's first entry; if it is full, the file 
+         may go on into another. */
+      if (fcbbuf[DE_RC] == BD_EXT_RECS)
+        d->attr |= DA_NOSZ;
+      if (cur->nbuf == DC_BATCH) break;
+      }
+    n = bdos (BDOS_DNEXT, cur->fcb);
+    }
+
+  if (n == 255) cur->done = TRUE;
+  cur->live = (cur->flags & DST_NOIO) != 0;
+  if (cur->allu && cur->drive != cur->old_drive) 
+    bd_sel_drv (cur->old_drive);
+
+  if (cur->flags & DST_SZ)
+    {
+    for (i = 0; i < cur->nbuf; i++)
+      {
+      if (cur->buf[i].attr & DA_NOSZ) 
+        {
+        size_ent (cur->drive, &cur->buf[i]);
+        cur->live = FALSE;
+        }
+      }
     }
-  return d;
   }
 
+/*===========================================================================
+
+  dirs_next
+
+===========================================================================*/
+dirent *dirs_next (cur)
+dircur *cur;
+  {
+  if (cur->next == cur->nbuf)
+    fill_cur (cur);
+  if (cur->next == cur->nbuf)
+    return 0;
+  return &cur->buf[cur->next++];
+  }
+
+/*===========================================================================
+
+  dirs_close
+
+===========================================================================*/
+void dirs_close (cur)
+dircur *cur;
+  {
+  if (cur->mt) free (cur->mt);
+  free (cur);
+  }
 
@@ -12,33 +12,172 @@
 
 #include "defs.h"
 #include "bdos.h"
+#include "error.h"
+#include "match.h"
 
 /* Directory sort flags */
 #define DST_NAME  0x01
 #define DST_SIZE  0x02
 #define DST_ASC   0x00
 #define DST_DSC   0x04
+#define DST_EXT   0x08
 
 #define DST_SZ    0x10
 
+/* For dirs_open: the caller does no file operations between calls
+   to dirs_next, so the BDOS search can carry on where it left off. */
+#define DST_NOIO  0x20
+
+/* Include files from all user areas, in a single directory search */
+#define DST_ALLU  0x40
+
+/* Read the directory sectors through the BIOS where possible, rather
+   than searching one entry at a time through the BDOS */
+#define DST_RAW   0x80
+
+/* dirent attribute bits */
+#define DA_RO     0x01	/* Read-only (t1') */
+#define DA_SYS    0x02	/* System (t2') */
+#define DA_ARC    0x04	/* Archived (t3') */
+#define DA_NOSZ   0x08	/* recs is not known */
+#define DA_USER   0xF0	/* User number, in the top four bits */
+
+#define DIRS_USER(d) ((d)->attr >> 4)
+
+/* The largest size a dirent can hold. A file of the CP/M maximum, 8Mb,
+   is 65536 records, and is given this size rather than wrapping to 0. */
+#define DIRS_MAX_RECS 0xFFFF
+
+/* One file. The name is the raw FCB name -- eight characters and
+   three of extension, space-padded, upper case, with no terminator.
+   Use dirs_sname() or dirs_path() to get a printable name. This
+   structure is 14 bytes. */
 typedef struct _dirent
   {
-  Drive drive;
-  char name [BD_MAX_FNAME + 1];
-  char sname [BD_MAX_DFNAME + 1];
-  BOOL sys;
-  BOOL ro;
-  int recs;
+  char name [BD_MAX_FNAME];
+  uint8_t attr;
+  unsigned recs; /* Size in records; only reliable if DST_SZ was given */
   } dirent;
 
-/** Expand a drive's directory as an array of dirent structures. 
+/* The files on one drive, as returned by dirs_list(). ents[] is
+   really n entries long. */
+typedef struct _dirlist
+  {
+  Drive drive; /* A=1, B=2... never 0 */
+  int n;
+  dirent ents[1];
+  } dirlist;
+
+/* Files read by a dircur at a time */
+#define DC_BATCH 16
+
+/* A cursor for reading a directory one file at a time, as returned
+   by dirs_open(). */
+typedef struct _dircur
+  {
+  Drive drive; /* A=1, B=2... never 0 */
+  Drive old_drive;
+  uint8_t flags;
+  int user;
+  char mask [BD_MAX_FNAME];
+  mtpat *mt;    /* Compiled pattern, if it can't be a mask */
+  BOOL allu;    /* Searching all user areas */
+  uint8_t exm;  /* Extent mask, when searching all user areas */
+  BOOL live;    /* The BDOS search is still intact */
+  BOOL done;    /* The search has found the last file */
+  int seen;     /* Directory entries returned by the search so far */
+  int nbuf;
+  int next;
+  char fcb [36];
+  dirent buf [DC_BATCH];
+  } dircur;
+
+/* Bytes taken by a dirlist apart from its entries */
+#define DIRS_HDR (sizeof (dirlist) - sizeof (dirent))
+
+/* Upper bound on the size of a dirlist of n files. A full 2048-entry
+   directory needs less than 29K. */
+#define DIRS_BYTES(n) (DIRS_HDR + (unsigned)(n) * sizeof (dirent))
+
+/** Expand a drive's directory as a list of dirent structures. 
     The caller must call dirs_free to free the memory. Args:
     Drive drive, char *pattern, uint8_t flags. If the operation
-    fails, no memory is allocated (I hope), and errno will be set. */
-dirent **dirs_list ();
+    fails, no memory is allocated (I hope), and errno will be set.
+    The list is allocated as a single block, of DIRS_BYTES(n) bytes
+    for n files. While the directory is read, the block has room for
+    every entry the directory can hold, DIRS_BYTES(DRM + 1). */
+dirlist *dirs_list ();
 
-/** Free the array of dirent objects created by dirs_list. */
+/** The number of BDOS search-first/search-next calls made by the
+    most recent dirs_list(). The directory is read in a single pass,
+    so for a drive with n directory entries this is n + 1. If the
+    pattern uses only '?' and a trailing '*' in the name or 
+    extension, the BDOS does the matching, and n is just the number
+    of matching entries -- unless DST_ALLU was given, when n counts
+    every entry in the directory, used or not. If the directory was
+    read through the BIOS (DST_RAW), this is the number of sectors
+    read. */
+extern int dirs_ncalls;
+
+/** The size in bytes of the block allocated by the most recent
+    dirs_list(). */
+extern unsigned dirs_nbytes;
+
+/** Free the list created by dirs_list. */
 void dirs_free ();
 
-#endif /* dir.h */
+/** Write a dirent's name as "name.ext", in lower case, to buf, which
+    must have room for BD_MAX_DFNAME + 1 characters. Returns buf. */
+char *dirs_sname ();
+
+/** Write a dirent's name with its drive, as "A:name.ext", to buf,
+    which must have room for BD_MAX_PATH + 1 characters. Args:
+    Drive drive, dirent *d, char *buf. Returns buf. */
+char *dirs_path ();
+
+/** TRUE if a dirent's name matches a pattern. Args: dirent *d,
+    char *mask, mtpat *mt. If mt is not 0, it is the compiled 
+    pattern; otherwise mask is the pattern, from mt_mask(). */
+BOOL dirs_match ();
+
+/** Find a file by its raw FCB name, by binary search. Args: 
+    dirlist *list, char *name. The list must have been sorted by
+    DST_NAME alone, ascending, and be from one user area. Returns the
+    dirent, or 0. */
+dirent *dirs_find ();
 
+/** Reorder a list by the lowest allocation block of each file, so
+    that reading the files in list order moves the disk heads mostly
+    one way. Args: dirlist *list, which must be as dirs_find() needs
+    it, from the current user area. The directory is read once more.
+    Returns zero, or an error code. */
+ErrCode dirs_by_block ();
+
+/** A checksum of a drive's directory, which changes whenever a file
+    is created, deleted, renamed, grows or shrinks, or has its 
+    attributes changed. Args: Drive drive, char **skip. skip is 0, or
+    a list of raw FCB names, ending with 0, of files in the current 
+    user area to leave out. The directory is read through the BIOS 
+    where possible. */
+unsigned dirs_sum ();
+
+/** Start reading a drive's directory one file at a time, in
+    directory order, without building a list. Args: Drive drive,
+    char *pattern, uint8_t flags. Only DST_SZ, DST_NOIO and DST_ALLU
+    mean anything here.
+    Returns 0, and sets errno, if there is no memory. */
+dircur *dirs_open ();
+
+/** Get the next matching file, or 0 at the end. The dirent is only
+    valid until the next call. Files may be read, written, and 
+    created between calls, so long as the directory being read 
+    doesn't change; unless DST_NOIO was given, the search is 
+    restarted after every DC_BATCH files to allow for this. That
+    reads the directory again for each batch, so without DST_NOIO a
+    list from dirs_list() is usually the better choice. */
+dirent *dirs_next ();
+
+/** Finish with a cursor from dirs_open(). */
+void dirs_close ();
+
+#endif /* dir.h */
@@ -19,6 +19,7 @@
 #include "defs.h"
 #include "bdos.h"
 #include "dirs.h"
+#include "expand.h"
 #include "getopt.h"
 #include "error.h"
 #include "term.h"
@@ -43,7 +44,7 @@ int across = 0;
 /* Current number of lines written, for paging purposes. */
 int lines = 0;
 
-long total_rec = 0;
+long total_recs = 0;
 int total_files = 0; /* unlikely to be larger than 64k on CP/M */
 
 extern long lseek();
@@ -55,10 +56,10 @@ extern long lseek();
 ===========================================================================*/
 void du_report (file, recs, d_flag)
 char *file;
-int recs;
+unsigned recs;
 uint8_t d_flag;
   {
-  printf ("%-5d %s\r\n", recs, file);
+  printf ("%-5u %s\r\n", recs, file);
   if (lines++ ==  tm_rows - 2 && (d_flag & DF_PAGE))
     {
     while (lines == tm_rows - 1)
@@ -84,14 +85,14 @@ BOOL du_do_du (file, d_flag)
 char *file;
 uint8_t d_flag;
   {
-  static char f[26]; /* Too big for stack. */
+  static uint8_t f[36]; /* Too big for stack. */
   fcbinit (file, f);
   if (bdos (BDOS_OPEN, f) == 0)
     {
-    int recs;
+    unsigned recs;
     bdos (BDOS_FSIZE, f);
-    recs = f[33] + 256 * f[34];
-    total_rec += recs;
+    recs = f[35] ? DIRS_MAX_RECS : f[33] + 256 * f[34];
+    total_recs += recs;
     total_files++;
     if (d_flag & DF_VERB) du_report (file, recs,d_flag);
     }
@@ -121,74 +122,34 @@ void du_help ()
 
   du_expand
 
-  on entry, 'thing' is a file and/or drive spec
+  Count the files matched by the n arguments in args. Each may be a 
+  file and/or drive spec.
 
 ===========================================================================*/
-void du_expand (thing, d_flag)
-char *thing;
+void du_expand (n, args, d_flag)
+int n;
+char **args;
 uint8_t d_flag;
   {
-  dirent **dirs;
-  char *path = thing;
-  Drive drive = 0;
-  int colpos;
-
-  colpos = strchr (thing, ':'); 
-  if (colpos)
+  char *fn;
+  exargs *ex = ex_open (n, args, DST_SZ | DST_RAW, EX_LITERAL | EX_WARN);
+  if (!ex)
     {
-    if (colpos == thing + 1)
-      {
-      path = thing + 2;
-      drive = thing[0] - 'A' + 1;
-      if (drive < 1 || drive > 26)
-        {
-        fprintf (stderr, "\n%c: %s\n", thing[0], strerror (E_DLET));
-        return;
-        }
-      }
-    else
-      {
-      fprintf (stderr, "\n%s: %s\n", thing, strerror (E_FNAME));
-      return;
-      }
+    fprintf (stderr, "\n%s: %s\n", args[0], strerror (errno));
+    return;
     }
-
-  if (!path[0]) path = "*";
-
-  dirs = dirs_list (drive, path, DST_SZ); /* No need to sort. */ 
-  if (dirs)
+  while ((fn = ex_next (ex))) 
     {
-    BOOL match = FALSE;
-    int i = 0;
-    BOOL ok = TRUE;
-    while (dirs[i] && ok) 
+    if (!ex->d)
       {
-      char fn [BD_MAX_PATH + 1];
-      char fn2 [BD_MAX_PATH + 1];
-      Drive drive = dirs[i]->drive; 
-      if (dirs[i]->drive == 0)
-        drive = bd_cur_drv(); 
-
-      fn[0] = (drive - 1) + 'A';
-      fn[1] = ':';
-      strcpy (fn + 2, dirs[i]->sname);
-
-      total_recs += dirs[i]->recs; 
-      total_files++;
-      if (d_flag & DF_VERB) du_report (fn, dirs[i]->recs, d_flag);
-
-      match = TRUE;
-      i++;
+      du_do_du (fn, d_flag);
+      continue;
       }
-    dirs_free (dirs);
-    if (!match)
-      fprintf (stderr, "%s: no matching files\r\n", thing);
-    }
-  else
-    {
-    fprintf (stderr, "\n%s: %s\n", thing, strerror (errno));
-    return;
+    total_recs += ex->d->recs; 
+    total_files++;
+    if (d_flag & DF_VERB) du_report (fn, ex->d->recs, d_flag);
     }
+  ex_close (ex);
   }
 
 /*===========================================================================
@@ -200,7 +161,7 @@ int main (argc, argv)
 int argc;
 char **argv;
   {
-  int i, opt, myargs;
+  int opt, myargs;
   uint8_t d_flag = 0;
 
   argv[0] = "du";
@@ -221,18 +182,11 @@ char **argv;
   tm_size (&tm_rows, &tm_cols);
   myargs = argc - optind;
   if (myargs >= 1)
-    {
-    char *arg1 = argv[optind];
-    if (strchr (arg1, '*') || strchr (arg1, '?'))
-      du_expand (arg1, d_flag);
-    else if (arg1[1] == ':')
-      du_expand (arg1, d_flag);
-    else 
-      du_do_du (arg1, d_flag);
-    }
+    du_expand (myargs, argv + optind, d_flag);
   else
     {
-    du_expand ("*", d_flag);
+    static char *all[] = { "*" };
+    du_expand (1, all, d_flag);
     }
 
   printf ("%d file%s, %ld record%s, %ld bytes\r\n", 
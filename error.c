@@ -38,6 +38,11 @@ ErrCode err;
     case E_FNAME: return "Bad filename";
     case E_EDIR: return "Can't enumerate drive";
     case E_DLET: return "Bad drive letter";
+    case E_DISKF: return "Disk full";
+    case E_DIRF: return "Directory full";
+    case E_IO: return "I/O error";
+    case E_XDRV: return "Can't rename to a different drive";
+    case E_VERIFY: return "Verify failed";
     default: return "Unknown error";
     }
   }
@@ -17,6 +17,21 @@
 /* Bad drive letter */
 #define E_DLET 3
 
+/* Disk full */
+#define E_DISKF 4
+
+/* Directory full */
+#define E_DIRF 5
+
+/* BDOS read or write failed */
+#define E_IO 6
+
+/* Rename to a different drive */
+#define E_XDRV 7
+
+/* A copy read back differently */
+#define E_VERIFY 8
+
 typedef int ErrCode;
 
 extern int errno;
@@ -0,0 +1,299 @@
+/*===========================================================================
+
+  expand.c
+
+  Command-line arguments like "a:*.c a:*.h b:*.com" are grouped by
+  drive, and each drive's directory is read only once. If only one
+  argument refers to a drive, the BDOS search can do the matching as
+  usual, and if no sorting is wanted and the caller does no file I/O
+  while the arguments are expanded, the files are read with a 
+  dirs_open() cursor rather than listed. Otherwise all the drive's 
+  files are listed, and each argument is matched against the list in
+  memory. A drive's list is freed after the last argument that needs 
+  it.
+
+  Copyright (c)2021 Kevin Boone, GPL v3.0
+
+===========================================================================*/
+
+#include "stdio.h"
+#include "errno.h"
+#include "ctype.h"
+#include "defs.h"
+#include "bdos.h"
+#include "error.h"
+#include "compat.h"
+#include "dirs.h"
+#include "expand.h"
+
+/*===========================================================================
+
+  ex_parse
+
+  Split an argument into drive and pattern. On entry 'thing' may be a
+  file, a file pattern including drive, or just a drive. If there's a
+  drive, the : must be in position 1, or it's a bad filename.
+
+===========================================================================*/
+static void ex_parse (a, thing, opts)
+exarg *a;
+char *thing;
+uint8_t opts;
+  {
+  char *colpos;
+
+  a->arg = thing;
+  a->pattern = thing;
+  a->drive = 0;
+  a->literal = FALSE;
+  a->mt = 0;
+
+  colpos = strchr (thing, ':'); 
+  if (colpos)
+    {
+    if (colpos == thing + 1)
+      {
+      a->pattern = thing + 2;
+      a->drive = thing[0] - 'A' + 1;
+      if (a->drive < 1 || a->drive > 26)
+        {
+        fprintf (stderr, "\n%c: %s\n", thing[0], strerror (E_DLET));
+        a->drive = 0;
+        return;
+        }
+      }
+    else
+      {
+      fprintf (stderr, "\n%s: %s\n", thing, strerror (E_FNAME));
+      return;
+      }
+    }
+  else
+    a->drive = bd_cur_drv ();
+
+  if ((opts & EX_LITERAL) && a->pattern[0]
+      && !strchr (a->pattern, '*') && !strchr (a->pattern, '?')
+      && !strchr (a->pattern, '['))
+    {
+    a->literal = TRUE;
+    return;
+    }
+
+  if (!a->pattern[0]) a->pattern = "*";
+  if (!mt_mask (a->pattern, a->mask))
+    {
+    a->mt = malloc (sizeof (mtpat));
+    if (a->mt) 
+      mt_compile (a->pattern, a->mt);
+    else
+      {
+      fprintf (stderr, "\n%s: %s\n", thing, strerror (ENOMEM));
+      a->drive = 0;
+      }
+    }
+  }
+
+/*===========================================================================
+
+  ex_cursor
+
+  Whether an argument's files are read with a cursor: it must be the
+  only argument for its drive, the order mustn't matter, and the 
+  search mustn't be disturbed. A cursor that has to restart its 
+  search for every batch would read the directory over and over, 
+  where a list reads it once.
+
+===========================================================================*/
+static BOOL ex_cursor (ex, a)
+exargs *ex;
+exarg *a;
+  {
+  return ex->npat[a->drive - 1] == 1 && (ex->flags & DST_NOIO)
+      && !(ex->flags & (DST_NAME | DST_SIZE | DST_EXT));
+  }
+
+/*===========================================================================
+
+  ex_scan
+
+  Read the directory of an argument's drive, if that hasn't been done.
+
+===========================================================================*/
+static void ex_scan (ex, a)
+exargs *ex;
+exarg *a;
+  {
+  int i = a->drive - 1;
+  if (ex->scanned[i]) return;
+  ex->scanned[i] = TRUE;
+  ex->lists[i] = dirs_list (a->drive, 
+     ex->npat[i] > 1 ? "*" : a->pattern, ex->flags);
+  if (!ex->lists[i])
+    fprintf (stderr, "\n%s: %s\n", a->arg, strerror (errno));
+  }
+
+/*===========================================================================
+
+  ex_open
+
+===========================================================================*/
+exargs *ex_open (argc, argv, flags, opts)
+int argc;
+char **argv;
+uint8_t flags;
+uint8_t opts;
+  {
+  int i;
+  exargs *ex = malloc (sizeof (exargs));
+  if (!ex)
+    {
+    errno = ENOMEM;
+    return 0;
+    }
+  memset (ex, 0, sizeof (exargs));
+  ex->args = malloc ((argc ? argc : 1) * sizeof (exarg));
+  if (!ex->args)
+    {
+    free (ex);
+    errno = ENOMEM;
+    return 0;
+    }
+  ex->argc = argc;
+  ex->flags = flags;
+  ex->opts = opts;
+  ex->arg = -1;
+
+  for (i = 0; i < argc; i++)
+    {
+    exarg *a = &ex->args[i];
+    ex_parse (a, argv[i], opts);
+    if (a->drive && !a->literal)
+      {
+      ex->npat[a->drive - 1]++;
+      ex->last[a->drive - 1] = i;
+      }
+    }
+  if (opts & EX_SCAN)
+    {
+    for (i = 0; i < argc; i++)
+      {
+      exarg *a = &ex->args[i];
+      if (a->drive && !a->literal && !ex_cursor (ex, a)) 
+        ex_scan (ex, a);
+      }
+    }
+  return ex;
+  }
+
+/*===========================================================================
+
+  ex_start
+
+  Start on the files for an argument: open a cursor if ex_cursor()
+  says so, or else make sure the drive has been listed.
+
+===========================================================================*/
+static void ex_start (ex, a)
+exargs *ex;
+exarg *a;
+  {
+  if (ex_cursor (ex, a))
+    {
+    ex->cur = dirs_open (a->drive, a->pattern, 
+      ex->flags & (DST_SZ | DST_NOIO | DST_ALLU));
+    if (!ex->cur)
+      fprintf (stderr, "\n%s: %s\n", a->arg, strerror (errno));
+    }
+  else
+    ex_scan (ex, a);
+  }
+
+/*===========================================================================
+
+  ex_next
+
+===========================================================================*/
+char *ex_next (ex)
+exargs *ex;
+  {
+  exarg *a;
+  for (;;)
+    {
+    if (ex->arg >= 0)
+      {
+      a = &ex->args[ex->arg];
+      if (ex->cur)
+        {
+        dirent *d = dirs_next (ex->cur);
+        if (d)
+          {
+          ex->found++;
+          ex->drive = a->drive;
+          ex->d = d;
+          return dirs_path (a->drive, d, ex->path);
+          }
+        dirs_close (ex->cur);
+        ex->cur = 0;
+        if (!ex->found && (ex->opts & EX_WARN))
+          fprintf (stderr, "%s: no files matched\r\n", a->arg); 
+        }
+      else if (a->drive && !a->literal)
+        {
+        int i = a->drive - 1;
+        dirlist *list = ex->lists[i];
+        while (list && ex->next < list->n)
+          {
+          dirent *d = &list->ents[ex->next++];
+          /* If this is the drive's only argument, the list holds
+             only matching files already. */
+          if (ex->npat[i] == 1 
+              || dirs_match (d, a->mask, a->mt))
+            {
+            ex->found++;
+            ex->drive = a->drive;
+            ex->d = d;
+            return dirs_path (a->drive, d, ex->path);
+            }
+          }
+        if (list && !ex->found && (ex->opts & EX_WARN))
+          fprintf (stderr, "%s: no files matched\r\n", a->arg); 
+        if (ex->last[i] == ex->arg && list)
+          {
+          dirs_free (list);
+          ex->lists[i] = 0;
+          }
+        }
+      }
+
+    if (++ex->arg >= ex->argc) return 0;
+    a = &ex->args[ex->arg];
+    ex->next = 0;
+    ex->found = 0;
+    if (a->literal)
+      {
+      ex->drive = 0;
+      ex->d = 0;
+      return a->arg;
+      }
+    if (a->drive) ex_start (ex, a);
+    }
+  }
+
+/*===========================================================================
+
+  ex_close
+
+===========================================================================*/
+void ex_close (ex)
+exargs *ex;
+  {
+  int i;
+  if (ex->cur) dirs_close (ex->cur);
+  for (i = 0; i < 26; i++)
+    if (ex->lists[i]) dirs_free (ex->lists[i]);
+  for (i = 0; i < ex->argc; i++)
+    if (ex->args[i].mt) free (ex->args[i].mt);
+  free (ex->args);
+  free (ex);
+  }
+
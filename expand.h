@@ -0,0 +1,79 @@
+/*===========================================================================
+
+  expand.h
+
+  Expansion of wildcard command-line arguments, with one directory
+  scan for each drive however many arguments refer to it.
+
+  Copyright (c)2021 Kevin Boone, GPL v3.0
+
+===========================================================================*/
+#ifndef __EXPAND_H
+#define __EXPAND_H
+
+#include "defs.h"
+#include "bdos.h"
+#include "dirs.h"
+
+/* Options for ex_open() */
+
+/* Arguments with no wildcards, and a filename, are passed through 
+   without looking at the directory */
+#define EX_LITERAL 0x01
+/* Complain about arguments that match no files */
+#define EX_WARN    0x02
+/* Read every directory that will be listed in ex_open(), rather than
+   when its first argument is reached, so that the memory is taken 
+   before the caller allocates its own */
+#define EX_SCAN    0x04
+
+/* One command-line argument */
+typedef struct _exarg
+  {
+  char *arg;      /* As given */
+  char *pattern;  /* The part after the drive */
+  Drive drive;    /* A=1, B=2..., or 0 if the argument is bad */
+  BOOL literal;   /* Passed through unexpanded */
+  char mask [BD_MAX_FNAME];
+  mtpat *mt;      /* Compiled pattern, if it can't be a mask */
+  } exarg;
+
+typedef struct _exargs
+  {
+  int argc;
+  exarg *args;
+  uint8_t flags;  /* DST_ flags for dirs_list() */
+  uint8_t opts;
+  dirlist *lists [26];  /* Each drive's files, while still needed */
+  dircur *cur;    /* Files for the current argument, if not listed */
+  BOOL scanned [26];
+  int npat [26];  /* Number of arguments for each drive */
+  int last [26];  /* The last argument for each drive */
+  int arg;        /* The argument being expanded */
+  int next;       /* Next entry to try in its drive's list */
+  int found;      /* Files it has matched so far */
+  /* The current file, as set by ex_next() */
+  Drive drive;    /* 0 for a literal argument */
+  dirent *d;      /* 0 for a literal argument */
+  char path [BD_MAX_PATH + 1];
+  } exargs;
+
+/** Prepare to expand arguments. Args: int argc, char **argv, 
+    uint8_t flags, uint8_t opts. flags are passed to dirs_list() or
+    dirs_open(), and say how the files that match each argument are
+    ordered; DST_NOIO may only be given if no file I/O is done while
+    the arguments are expanded. Bad drive
+    letters and filenames are reported here. Returns 0, and sets errno,
+    if there is no memory. */
+exargs *ex_open ();
+
+/** Get the next file, as "A:name.ext", or 0 when there are no more. 
+    Files come in argument order. A literal argument is returned as it
+    was given. The result, and ex->d, are only valid until the next 
+    call. */
+char *ex_next ();
+
+/** Finish with the expansion, and free its memory. */
+void ex_close ();
+
+#endif /* expand.h */
@@ -24,6 +24,7 @@
 
 #define DF_VERB 0x01
 #define DF_PAGE 0x02
+#define DF_USER 0x04
 
 /*===========================================================================
 
@@ -46,9 +47,10 @@ int lines = 0;
 void find_help ()
   {
   /* TODO */
-  printf ("Usage: find [/p] {pattern}\r\n");
+  printf ("Usage: find [/ap] {pattern}\r\n");
   printf ("Searches drives for files matching the pattern.\r\n");
   printf ("Options:\r\n");
+  printf ("  /a  all user areas\r\n");
   printf ("  /p  page mode\n");
   }
 
@@ -62,15 +64,19 @@ Drive drive;
 char *pattern;
 uint8_t d_flag;  
   {
-  dirent **dirs = dirs_list (drive, pattern, 0); 
-printf ("df=%02x\n", d_flag);
-  if (dirs)
+  dircur *cur = dirs_open (drive, pattern, 
+    (d_flag & DF_USER) ? (DST_NOIO | DST_ALLU) : DST_NOIO); 
+  if (cur)
     {
-    int i = 0;
-    while (dirs[i]) 
+    dirent *d;
+    while ((d = dirs_next (cur))) 
       {
-      printf ("%c:%s\r\n", drive + 'A' - 1, dirs[i]->sname);
-      i++;
+      char fn [BD_MAX_PATH + 1];
+      if (d_flag & DF_USER)
+        printf ("%c%d:%s\r\n", 'A' + drive - 1, DIRS_USER (d), 
+          dirs_sname (d, fn));
+      else
+        printf ("%s\r\n", dirs_path (drive, d, fn));
       if (lines++ ==  tm_rows - 2 && (d_flag & DF_PAGE))
 	{
 	while (lines == tm_rows - 1)
@@ -86,7 +92,7 @@ printf ("df=%02x\n", d_flag);
 	  }
         }
       }
-    dirs_free (dirs);
+    dirs_close (cur);
     }
   } 
 
@@ -104,13 +110,14 @@ char **argv;
 
   argv[0] = "find";
   
-  while ((opt = getopt (argc, argv, "HVP")) != -1)  
+  while ((opt = getopt (argc, argv, "AHVP")) != -1)  
     {
     switch (opt)
       {
       case 'H':
         find_help ();
         exit (0);
+      case 'A': d_flag |= DF_USER; break;
       case 'V': d_flag |= DF_VERB; break;
       case 'P': d_flag |= DF_PAGE; break;
       default: exit (-1); 
@@ -125,7 +132,8 @@ char **argv;
     int i;
     for (i = 1; i <= 26; i++)
       {
-      find_on_drive (i, argv[optind], d_flag);
+      if (bd_drv_ok (i))
+        find_on_drive (i, argv[optind], d_flag);
       } 
     }
   else
@@ -17,6 +17,7 @@
 #include "defs.h"
 #include "bdos.h"
 #include "dirs.h"
+#include "expand.h"
 #include "getopt.h"
 #include "error.h"
 #include "term.h"
@@ -122,8 +123,8 @@ uint8_t d_flag;
   long offset = file_offset; 
   do
     {
-    memcpy (buff, (uint8_t *)offset, BD_SEC_SIZE);
-    hd_fmt_sec (offset, BD_SEC_SIZE, d_flag);
+    memcpy (buff, (uint8_t *)offset, BD_SEC_SZ);
+    hd_fmt_sec (offset, BD_SEC_SZ, d_flag);
     offset += BD_SEC_SZ;
     } while (offset < 65536L);
   }
@@ -166,80 +167,6 @@ uint8_t d_flag;
     fprintf (stderr, "%s: %s\r\n", filename, strerror (ENOENT));
   }
 
-/*===========================================================================
-
-  hd_expand
-
-  On entry 'thing' may be a file, a file pattern including drive, or
-  just a drive. If there's a drive, the : must be in position 1, or it's
-  a bad filename.
-===========================================================================*/
-void hd_expand (thing, d_flag)
-char *thing;
-uint8_t d_flag;
-  {
-  dirent **dirs;
-  char *path = thing;
-  Drive drive = 0;
-  int colpos;
-  BOOL page = FALSE;
-
-  if (d_flag & DF_PAGE)
-    page = TRUE;
-
-  colpos = strchr (thing, ':'); 
-  if (colpos)
-    {
-    if (colpos == thing + 1)
-      {
-      path = thing + 2;
-      drive = thing[0] - 'A' + 1;
-      if (drive < 1 || drive > 26)
-        {
-	fprintf (stderr, "\n%c: %s\n", thing[0], strerror (E_DLET));
-        return;
-	}
-      }
-    else
-      {
-      fprintf (stderr, "\n%s: %s\n", thing, strerror (E_FNAME));
-      return;
-      }
-    }
-
-  if (!path[0]) path = "*";
-
-  dirs = dirs_list (drive, path, 0); /* Don't sort or set size */
-  if (dirs)
-    {
-    int i = 0;
-    while (dirs[i]) 
-      {
-      char fn[BD_MAX_PATH + 1];
-      Drive drive = dirs[i]->drive; 
-      if (dirs[i]->drive == 0)
-        drive = bd_cur_drv(); 
-
-      fn[0] = (drive - 1) + 'A';
-      fn[1] = ':';
-      strcpy (fn + 2, dirs[i]->sname);
-
-      hd_do_file (fn, d_flag);
-
-      i++;
-      }
-    dirs_free (dirs);
-    if (i == 0)
-      fprintf (stderr, "%s: no files matched\r\n", thing); 
-    printf ("\r\n");
-    }
-  else
-    {
-    fprintf (stderr, "\n%s: %s\n", thing, strerror (errno));
-    return;
-    }
-  }
-
 /*===========================================================================
 
   hd_help 
@@ -268,7 +195,7 @@ int main (argc, argv)
 int argc;
 char **argv;
   {
-  int i, opt;
+  int opt;
   uint8_t d_flag = 0;
   BOOL mem = FALSE;
 
@@ -305,14 +232,17 @@ char **argv;
     }
   else
     {
-    for (i = optind; i < argc; i++)
+    exargs *ex = ex_open (argc - optind, argv + optind, 0, 
+      EX_LITERAL | EX_WARN);
+    if (ex)
       {
-      char *arg = argv[i];
-      if (strchr (arg, '*') || strchr (arg, '?'))
-        hd_expand (argv[i], d_flag);
-      else 
-        hd_do_file (arg, d_flag);
+      char *fn;
+      while ((fn = ex_next (ex)))
+        hd_do_file (fn, d_flag);
+      ex_close (ex);
       }
+    else
+      fprintf (stderr, "%s: %s\r\n", argv[0], strerror (errno));
     }
 
   return 0;
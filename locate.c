@@ -0,0 +1,524 @@
+/*===========================================================================
+
+  locate.c
+
+  Main body of the "locate" command. See the locate_help() function for
+  command line usage.
+
+  "locate /u" scans every drive that exists, in all user areas, and
+  writes a catalog file. Other invocations look files up in the
+  catalog, without reading any directory.
+
+  The catalog is a sequence of 16-byte records. The first LC_HDR_RECS
+  records are the header: a magic string, and then a table with an
+  entry for each drive. Each drive's files follow, as a contiguous
+  run of records sorted by name and then by user, so an exact name
+  can be looked up by binary search. Each drive's entry holds a
+  checksum of its directory entries, and a drive whose checksum hasn't
+  changed since the last update is copied from the old catalog rather
+  than scanned again. Working out the checksum still reads the 
+  directory, but through the BIOS where possible, and without 
+  building, sorting or writing a list.
+
+  Copyright (c)2021 Kevin Boone, GPL v3.0
+
+===========================================================================*/
+
+#include "stdio.h"
+#include "fcntl.h"
+#include "errno.h"
+#include "ctype.h"
+#include "config.h"
+#include "compat.h"
+#include "defs.h"
+#include "bdos.h"
+#include "dirs.h"
+#include "getopt.h"
+#include "error.h"
+#include "term.h"
+
+#define DF_PAGE 0x01
+#define DF_UPD  0x02
+#define DF_FORCE 0x04
+
+#define LC_MAGIC "LOCATE1"
+#define LC_NDRV 26
+/* Size of the header, in records. It is a whole number of 128-byte
+   sectors, so it can be rewritten in place. */
+#define LC_HDR_RECS 32
+#define LC_REC_SZ 16
+
+/* One file. The dirent comes first, so the record can be handed to
+   dirs_sname(); the user number is in the dirent's attr. */
+typedef struct _lcrec
+  {
+  dirent ent;
+  Drive drive;
+  uint8_t pad;
+  } lcrec;
+
+/* One drive's entry in the header */
+typedef struct _lcdrv
+  {
+  BOOL present;   /* The drive was scanned */
+  uint8_t pad;
+  unsigned stamp; /* dirs_sum() when it was scanned */
+  unsigned first; /* Record number of its first file */
+  unsigned n;     /* Number of files */
+  char pad2 [8];
+  } lcdrv;
+
+typedef struct _lchdr
+  {
+  char magic [LC_REC_SZ];
+  lcdrv drv [LC_NDRV];
+  char pad [LC_REC_SZ * (LC_HDR_RECS - 1 - LC_NDRV)];
+  } lchdr;
+
+/*===========================================================================
+
+  globals
+
+===========================================================================*/
+/* Terminal size. */
+int tm_rows;
+int tm_cols;
+
+/* Current number of lines written, for paging purposes. */
+int lines = 0;
+
+/* Header of the catalog being read, and of the one being written */
+lchdr old_hdr;
+lchdr new_hdr;
+
+/* Records being copied */
+lcrec buff [8];
+
+/*===========================================================================
+
+  locate_help
+
+===========================================================================*/
+void locate_help ()
+  {
+  printf ("Usage: locate [/p] {pattern}\r\n");
+  printf ("       locate /u [/f]\r\n");
+  printf ("Looks up files, on all drives and user areas, in the catalog\r\n");
+  printf ("%s. The pattern may start with a drive letter.\r\n", LC_DB);
+  printf ("Options:\r\n");
+  printf ("  /f  with /u, scan every drive, even if unchanged\r\n");
+  printf ("  /p  page mode\r\n");
+  printf ("  /u  update the catalog\r\n");
+  }
+
+/*===========================================================================
+
+  lc_seek
+
+  Move to record r of the catalog.
+
+===========================================================================*/
+void lc_seek (fd, r)
+int fd;
+unsigned r;
+  {
+  lseek (fd, (long)r * (long)LC_REC_SZ, 0);
+  }
+
+/*===========================================================================
+
+  lc_is_db
+
+  TRUE if a file is the catalog, or the file it is being built in;
+  these are left out, because they will have changed by the time the
+  catalog is read.
+
+===========================================================================*/
+BOOL lc_is_db (drive, d)
+Drive drive;
+dirent *d;
+  {
+  char mask [BD_MAX_FNAME];
+  if (drive != LC_DB[0] - 'A' + 1 || DIRS_USER (d) != bd_cur_usr ()) 
+    return FALSE;
+  mt_mask (LC_DB + 2, mask);
+  if (strncmp (mask, d->name, BD_MAX_FNAME) == 0) return TRUE;
+  mt_mask (LC_TMP + 2, mask);
+  return strncmp (mask, d->name, BD_MAX_FNAME) == 0;
+  }
+
+/*===========================================================================
+
+  lc_scan
+
+  Write the files on one drive to the new catalog. Returns the number
+  of records written, or -1 on error.
+
+===========================================================================*/
+int lc_scan (fd, drive)
+int fd;
+Drive drive;
+  {
+  int i, n = 0;
+  dirlist *dirs = dirs_list (drive, "*",
+    DST_NAME | DST_ALLU | DST_SZ | DST_RAW);
+  if (!dirs)
+    {
+    fprintf (stderr, "%c: %s\r\n", 'A' + drive - 1, strerror (errno));
+    return -1;
+    }
+  for (i = 0; i < dirs->n; i++)
+    {
+    lcrec r;
+    if (lc_is_db (drive, &dirs->ents[i])) continue;
+    memcpy (&r.ent, &dirs->ents[i], sizeof (dirent));
+    r.drive = drive;
+    r.pad = 0;
+    if (write (fd, &r, LC_REC_SZ) != LC_REC_SZ)
+      {
+      dirs_free (dirs);
+      return -1;
+      }
+    n++;
+    }
+  dirs_free (dirs);
+  return n;
+  }
+
+/*===========================================================================
+
+  lc_copy
+
+  Copy n records, starting at record first, from the old catalog to
+  the end of the new one. Returns FALSE on error.
+
+===========================================================================*/
+BOOL lc_copy (fd_old, fd, first, n)
+int fd_old;
+int fd;
+unsigned first;
+unsigned n;
+  {
+  lc_seek (fd_old, first);
+  while (n > 0)
+    {
+    int k = n < 8 ? n : 8;
+    int bytes = k * LC_REC_SZ;
+    if (read (fd_old, buff, bytes) != bytes) return FALSE;
+    if (write (fd, buff, bytes) != bytes) return FALSE;
+    n -= k;
+    }
+  return TRUE;
+  }
+
+/*===========================================================================
+
+  lc_write_hdr
+
+  Write the header at the start of a catalog. Returns FALSE on error.
+
+===========================================================================*/
+BOOL lc_write_hdr (fd, hdr)
+int fd;
+lchdr *hdr;
+  {
+  lc_seek (fd, 0);
+  return write (fd, hdr, sizeof (lchdr)) == sizeof (lchdr);
+  }
+
+/*===========================================================================
+
+  lc_read_hdr
+
+  Open the catalog and read its header. Returns the file descriptor,
+  or -1 if there is no usable catalog.
+
+===========================================================================*/
+int lc_read_hdr (hdr, mode)
+lchdr *hdr;
+int mode;
+  {
+  int fd = open (LC_DB, mode);
+  if (fd < 0) return -1;
+  if (read (fd, hdr, sizeof (lchdr)) != sizeof (lchdr)
+      || strcmp (hdr->magic, LC_MAGIC) != 0)
+    {
+    close (fd);
+    return -1;
+    }
+  return fd;
+  }
+
+/*===========================================================================
+
+  locate_update
+
+  Write a new catalog. Drives whose directory checksum is the
+  same as in the old catalog are copied from it, unless force is set.
+  The catalog is built in a temporary file, which replaces the old
+  one at the end. Returns FALSE on error.
+
+===========================================================================*/
+BOOL locate_update (force)
+BOOL force;
+  {
+  int fd, fd_old;
+  unsigned next = LC_HDR_RECS;
+  Drive drive;
+  Drive db_drive = LC_DB[0] - 'A' + 1;
+  BOOL ok = TRUE;
+  char db_name [BD_MAX_FNAME];
+  char tmp_name [BD_MAX_FNAME];
+  char *skip [3];
+
+  mt_mask (LC_DB + 2, db_name);
+  mt_mask (LC_TMP + 2, tmp_name);
+  skip[0] = db_name;
+  skip[1] = tmp_name;
+  skip[2] = 0;
+
+  fd_old = force ? -1 : lc_read_hdr (&old_hdr, O_RDONLY);
+
+  fd = open (LC_TMP, O_WRONLY | O_CREAT | O_TRUNC);
+  if (fd < 0)
+    {
+    fprintf (stderr, "%s: %s\r\n", LC_TMP, strerror (errno));
+    if (fd_old >= 0) close (fd_old);
+    return FALSE;
+    }
+
+  /* Leave room for the header, which is filled in at the end. */
+  memset (&new_hdr, 0, sizeof (lchdr));
+  ok = lc_write_hdr (fd, &new_hdr);
+  strcpy (new_hdr.magic, LC_MAGIC);
+
+  for (drive = 1; drive <= LC_NDRV && ok; drive++)
+    {
+    lcdrv *nd = &new_hdr.drv[drive - 1];
+    lcdrv *od = &old_hdr.drv[drive - 1];
+    int n;
+
+    if (!bd_drv_ok (drive)) continue;
+
+    /* The catalog and the file it is built in are left out of 
+       their drive's checksum, or writing them would make the drive
+       look changed every time */
+    nd->stamp = dirs_sum (drive, drive == db_drive ? skip : 0);
+    if (fd_old >= 0 && od->present && od->stamp == nd->stamp)
+      {
+      ok = lc_copy (fd_old, fd, od->first, od->n);
+      n = od->n;
+      }
+    else
+      {
+      printf ("Scanning %c:\r\n", 'A' + drive - 1);
+      n = lc_scan (fd, drive);
+      ok = n >= 0;
+      }
+    nd->present = TRUE;
+    nd->first = next;
+    nd->n = n;
+    next += n;
+    }
+
+  if (fd_old >= 0) close (fd_old);
+
+  if (ok) ok = lc_write_hdr (fd, &new_hdr);
+  if (close (fd) != 0) ok = FALSE;
+  if (!ok)
+    {
+    fprintf (stderr, "%s: %s\r\n", LC_TMP, strerror (errno));
+    unlink (LC_TMP);
+    return FALSE;
+    }
+
+  unlink (LC_DB);
+  if (rename (LC_TMP, LC_DB) != 0)
+    {
+    fprintf (stderr, "%s: %s\r\n", LC_DB, strerror (errno));
+    return FALSE;
+    }
+
+  printf ("%u files\r\n", next - LC_HDR_RECS);
+  return TRUE;
+  }
+
+/*===========================================================================
+
+  lc_print
+
+===========================================================================*/
+void lc_print (r, d_flag)
+lcrec *r;
+uint8_t d_flag;
+  {
+  char sname [BD_MAX_DFNAME + 1];
+  printf ("%c%d:%s\r\n", 'A' + r->drive - 1, DIRS_USER (&r->ent),
+    dirs_sname (&r->ent, sname));
+  if (lines++ ==  tm_rows - 2 && (d_flag & DF_PAGE))
+    {
+    while (lines == tm_rows - 1)
+      {
+      int c = tm_g_rchar();
+      switch (c)
+        {
+        case I_INTR: exit(0);
+        case 13: case 10: lines = tm_rows - 2; break;
+        case ' ': lines = 0;
+        default: break;
+        }
+      }
+    }
+  }
+
+/*===========================================================================
+
+  lc_bsearch
+
+  Find the first record in a drive's run whose name is not less than
+  the name, and return its record number.
+
+===========================================================================*/
+unsigned lc_bsearch (fd, dv, name)
+int fd;
+lcdrv *dv;
+char *name;
+  {
+  unsigned lo = 0, hi = dv->n;
+  while (lo < hi)
+    {
+    unsigned mid = lo + (hi - lo) / 2;
+    lc_seek (fd, dv->first + mid);
+    read (fd, buff, LC_REC_SZ);
+    if (strncmp (buff[0].ent.name, name, BD_MAX_FNAME) < 0)
+      lo = mid + 1;
+    else
+      hi = mid;
+    }
+  return dv->first + lo;
+  }
+
+/*===========================================================================
+
+  locate
+
+  Print every file in the catalog that matches the pattern. An exact
+  name is found by binary search in each drive's run of records;
+  anything else is matched against every record. Returns the number
+  of files found.
+
+===========================================================================*/
+int locate (fd, thing, d_flag)
+int fd;
+char *thing;
+uint8_t d_flag;
+  {
+  char mask [BD_MAX_FNAME];
+  mtpat mt;
+  char *pattern = thing;
+  BOOL masked, exact;
+  Drive drive, from = 1, to = LC_NDRV;
+  int found = 0;
+
+  if (thing[0] && thing[1] == ':')
+    {
+    from = to = toupper (thing[0]) - 'A' + 1;
+    pattern = thing + 2;
+    if (from < 1 || from > LC_NDRV)
+      {
+      fprintf (stderr, "%c: %s\r\n", thing[0], strerror (E_DLET));
+      return 0;
+      }
+    }
+  if (!pattern[0]) pattern = "*";
+
+  masked = mt_mask (pattern, mask);
+  if (!masked) mt_compile (pattern, &mt);
+  exact = masked && !strchr (pattern, '?') && !strchr (pattern, '*');
+
+  for (drive = from; drive <= to; drive++)
+    {
+    lcdrv *dv = &old_hdr.drv[drive - 1];
+    unsigned r, end;
+
+    if (!dv->present) continue;
+
+    end = dv->first + dv->n;
+    r = exact ? lc_bsearch (fd, dv, mask) : dv->first;
+    lc_seek (fd, r);
+    for (; r < end; r++)
+      {
+      lcrec *rec = &buff[0];
+      if (read (fd, rec, LC_REC_SZ) != LC_REC_SZ) break;
+      if (dirs_match (&rec->ent, mask, masked ? 0 : &mt))
+        {
+        lc_print (rec, d_flag);
+        found++;
+        }
+      else if (exact)
+        break;
+      }
+    }
+  return found;
+  }
+
+/*===========================================================================
+
+  main
+
+===========================================================================*/
+int main (argc, argv)
+int argc;
+char **argv;
+  {
+  int opt, fd;
+  uint8_t d_flag = 0;
+
+  argv[0] = "locate";
+
+  while ((opt = getopt (argc, argv, "FHPU")) != -1)
+    {
+    switch (opt)
+      {
+      case 'H':
+        locate_help ();
+        exit (0);
+      case 'F': d_flag |= DF_FORCE | DF_UPD; break;
+      case 'P': d_flag |= DF_PAGE; break;
+      case 'U': d_flag |= DF_UPD; break;
+      default: exit (-1);
+      }
+    }
+
+  tm_size (&tm_rows, &tm_cols);
+
+  if (d_flag & DF_UPD)
+    {
+    if (optind != argc)
+      {
+      fprintf (stderr, "/u takes no file pattern.\r\n");
+      exit (EINVAL);
+      }
+    return locate_update ((d_flag & DF_FORCE) != 0) ? 0 : 1;
+    }
+
+  if (argc - optind != 1)
+    {
+    fprintf (stderr, "Specify one file pattern.\r\n");
+    exit (EINVAL);
+    }
+
+  fd = lc_read_hdr (&old_hdr, O_RDONLY);
+  if (fd < 0)
+    {
+    fprintf (stderr, "%s: no catalog; run \"locate /u\"\r\n", LC_DB);
+    exit (ENOENT);
+    }
+  if (locate (fd, argv[optind], d_flag) == 0)
+    fprintf (stderr, "%s: not found\r\n", argv[optind]);
+  close (fd);
+
+  return 0;
+  }
+
+
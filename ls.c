@@ -14,6 +14,7 @@
 #include "config.h"
 #include "defs.h"
 #include "dirs.h"
+#include "expand.h"
 #include "getopt.h"
 #include "error.h"
 #include "term.h"
@@ -21,6 +22,7 @@
 /* Display modes. */
 #define DF_LONG 0x01
 #define DF_PAGE 0x02
+#define DF_USER 0x04
 
 /*===========================================================================
 
@@ -39,25 +41,73 @@ int across = 0;
 /* Current number of lines written, for paging purposes. */
 int lines = 0;
 
+/*===========================================================================
+
+  ls_entry
+
+  Print one file, in short or long format, and page if necessary.
+
+===========================================================================*/
+void ls_entry (d, lng, page, user)
+dirent *d;
+BOOL lng;
+BOOL page;
+BOOL user;
+  {
+  char sname [BD_MAX_DFNAME + 1];
+  long size = (long)d->recs * (long)BD_SEC_SZ;
+  dirs_sname (d, sname);
+  if (user)
+    printf ("%2d ", DIRS_USER (d));
+  if (lng)
+    {
+    printf ("%-13s %2s %1s %ld", sname, 
+     (d->attr & DA_RO) ? "ro" : "rw", 
+     (d->attr & DA_SYS) ? "s" : " ", size);
+    }
+  else
+    printf ("%-13s", sname);
+  if (!lng)
+    across++;
+  if (lng || across == nacross)
+    {
+    printf ("\r\n");
+    across = 0;
+    if (lines++ ==  tm_rows - 2)
+      {
+      while (lines == tm_rows - 1 && page)
+        {
+        int c = tm_g_rchar(); 
+        switch (c)
+          {
+          case I_INTR: exit(0); 
+          case 13: case 10: lines = tm_rows - 2; break;
+          case ' ': lines = 0; 
+          default: break; 
+          }
+        }
+      }
+    }
+  }
+
 /*===========================================================================
 
   ls 
 
-  On entry 'thing' may be a file, a file pattern including drive, or
-  just a drive. If there's a drive, the : must be in position 1, or it's
-  a bad filename.
+  List the files matching the arguments. Each argument may be a file, 
+  a file pattern including drive, or just a drive. 
+
 ===========================================================================*/
-void ls (thing, flags, d_flag)
-char *thing;
+void ls (argc, argv, flags, d_flag)
+int argc;
+char **argv;
 uint8_t flags;
 uint8_t d_flag;
   {
-  dirent **dirs;
-  char *path = thing;
-  Drive drive = 0;
-  int colpos;
+  exargs *ex;
   BOOL lng = FALSE;
   BOOL page = FALSE;
+  BOOL user = FALSE;
 
   if (d_flag & DF_LONG)
     lng = TRUE;
@@ -65,75 +115,26 @@ uint8_t d_flag;
   if (d_flag & DF_PAGE)
     page = TRUE;
 
-  colpos = strchr (thing, ':'); 
-  if (colpos)
+  if (d_flag & DF_USER)
     {
-    if (colpos == thing + 1)
-      {
-      path = thing + 2;
-      drive = thing[0] - 'A' + 1;
-      if (drive < 1 || drive > 26)
-        {
-        fprintf (stderr, "\n%c: %s\n", thing[0], strerror (E_DLET));
-        return;
-        }
-      }
-    else
-      {
-      fprintf (stderr, "\n%s: %s\n", thing, strerror (E_FNAME));
-      return;
-      }
+    user = TRUE;
+    flags |= DST_ALLU;
     }
 
-  if (!path[0]) path = "*";
+  if (lng || (flags & DST_SIZE))
+    flags |= DST_SZ;
 
-  dirs = dirs_list (drive, path, flags | DST_SZ); 
-  if (dirs)
+  ex = ex_open (argc, argv, flags | DST_RAW | DST_NOIO, 0);
+  if (ex)
     {
-    int i = 0;
-    while (dirs[i]) 
-      {
-      long size = (long)dirs[i]->recs * (long)BD_SEC_SZ;
-      if (lng)
-        {
-        printf ("%-13s %2s %1s %ld", dirs[i]->sname, 
-         dirs[i]->ro ? "ro" : "rw", 
-         dirs[i]->sys ? "s" : " ", size);
-        }
-      else
-        printf ("%-13s", dirs[i]->sname);
-      if (!lng)
-        across++;
-      if (lng || across == nacross)
-        {
-        printf ("\r\n");
-        across = 0;
-        if (lines++ ==  tm_rows - 2)
-          {
-          while (lines == tm_rows - 1 && page)
-            {
-            int c = tm_g_rchar(); 
-            switch (c)
-              {
-              case I_INTR: exit(0); 
-              case 13: case 10: lines = tm_rows - 2; break;
-              case ' ': lines = 0; 
-              default: break; 
-              }
-            }
-          }
-        }
-      i++;
-      }
-    dirs_free (dirs);
+    while (ex_next (ex)) 
+      ls_entry (ex->d, lng, page, user);
+    ex_close (ex);
     if (across != 0)
       printf ("\r\n");
     }
   else
-    {
-    fprintf (stderr, "\n%s: %s\n", thing, strerror (errno));
-    return;
-    }
+    fprintf (stderr, "\n%s: %s\n", argv[0], strerror (errno));
   }
 
 /*===========================================================================
@@ -150,10 +151,13 @@ void ls_help ()
   printf ("Paths and options are case-insensitive. Filenames are sorted\r\n");
   printf ("by name by default.\r\n");
   printf ("Options:\r\n");
+  printf ("  /a  all user areas\r\n");
   printf ("  /l  long listing\r\n");
-  printf ("  /n  no sorting\r\n");
   printf ("  /p  page mode\r\n");
+  printf ("  /r  reverse sort order\r\n");
   printf ("  /s  sort by size\r\n");
+  printf ("  /u  no sorting\r\n");
+  printf ("  /x  sort by extension\r\n");
   }
 
 /*===========================================================================
@@ -166,19 +170,20 @@ int argc;
 char **argv;
   {
   ErrCode err_code;
-  int i, opt;
+  int opt;
   uint8_t srt_flag = DST_NAME;
   uint8_t d_flag = 0;
 
   argv[0] = "ls";
   
-  while ((opt = getopt (argc, argv, "LHPSU")) != -1)  
+  while ((opt = getopt (argc, argv, "ALHPRSUX")) != -1)  
     {
     switch (opt)
       {
       case 'H':
         ls_help ();
         exit (0);
+      case 'A': d_flag |= DF_USER; break;
       case 'L': d_flag |= DF_LONG; break;
       case 'P': d_flag |= DF_PAGE; break;
       case 'S': 
@@ -188,24 +193,25 @@ char **argv;
       case 'U': 
         srt_flag &= ~DST_NAME; 
         break;
+      case 'R': srt_flag |= DST_DSC; break;
+      case 'X': srt_flag |= DST_EXT; break;
       default: exit (-1); 
       }
     }
 
   tm_size (&tm_rows, &tm_cols);
-  nacross = tm_cols / (BD_MAX_DFNAME + 1);
+  if (d_flag & DF_USER)
+    nacross = tm_cols / (BD_MAX_DFNAME + 4);
+  else
+    nacross = tm_cols / (BD_MAX_DFNAME + 1);
 
   if (optind == argc)
     {
-    ls ("*", srt_flag, d_flag); 
+    static char *all[] = { "*" };
+    ls (1, all, srt_flag, d_flag); 
     }
   else
-    {
-    for (i = optind; i < argc; i++)
-      {
-      ls (argv[i], srt_flag, d_flag);
-      }
-    }
+    ls (argc - optind, argv + optind, srt_flag, d_flag);
 
   return 0;
   }
@@ -0,0 +1,312 @@
+/*===========================================================================
+
+  match.c
+
+  Filename patterns are compiled into a table that gives, for each 
+  character, the set of pattern positions it can fill, as the bits of
+  an unsigned. A name is then matched in a single pass, one shift 
+  and a couple of masks per character, with no backtracking: the 
+  state holds every position the name so far could have reached. 
+  A '*' is not a position, but lets the position before it stay 
+  reached whatever follows.
+
+  Case folding, '?' and bracket classes are all worked out when the 
+  pattern is compiled, so nothing is folded or tested while matching.
+
+  Simple patterns are compiled into FCB masks instead, so that the
+  BDOS search can do the matching. The compiled matcher treats the 
+  padding at the end of a short name or extension as the BDOS does, 
+  so a pattern means the same whichever way it is matched.
+
+  Copyright (c)2021 Kevin Boone, GPL v3.0
+
+===========================================================================*/
+
+#include "stdio.h"
+#include "ctype.h"
+#include "defs.h"
+#include "compat.h"
+#include "bdos.h"
+#include "match.h"
+
+/* tolower() of each character, built on first use */
+static uint8_t mt_fold [MT_NCHARS];
+static BOOL mt_folded = FALSE;
+
+/*===========================================================================
+
+  mt_init_fold
+
+===========================================================================*/
+static void mt_init_fold ()
+  {
+  register int c;
+  for (c = 0; c < MT_NCHARS; c++)
+    mt_fold[c] = tolower (c);
+  mt_folded = TRUE;
+  }
+
+/*===========================================================================
+
+  mt_class
+
+  Compile a bracket class into a 256-bit set. p points just after 
+  the '['. Returns a pointer to the
+  character after the ']', or 0 if the class is unterminated.
+
+===========================================================================*/
+static char *mt_class (p, set)
+register char *p;
+uint8_t *set;
+  {
+  BOOL negate;
+  register unsigned c, cstart, cend;
+  int i;
+
+  memset (set, 0, 32);
+  negate = (*p == '!' || *p == '^');
+  if (negate) p++;
+
+  c = (uint8_t)*p++;
+  for (;;)
+    {
+    cstart = c;
+    if (c == '\\')
+      {
+      cstart = (uint8_t)*p++;
+      if (!cstart) return 0;
+      }
+    if (c == 0) return 0;
+    cstart = cend = tolower (cstart);
+
+    c = tolower ((uint8_t)*p++);
+    if (c == '-' && *p != ']')
+      {
+      cend = (uint8_t)*p++;
+      if (cend == '\\') cend = (uint8_t)*p++;
+      if (cend == 0) return 0;
+      cend = tolower (cend);
+      c = tolower ((uint8_t)*p++);
+      }
+
+    for (i = cstart; i <= (int)cend; i++)
+      set[i >> 3] |= 1 << (i & 7);
+
+    if (c == ']') break;
+    }
+
+  if (negate)
+    for (i = 0; i < 32; i++) set[i] = ~set[i];
+  return p;
+  }
+
+/*===========================================================================
+
+  mt_compile
+
+===========================================================================*/
+void mt_compile (pattern, mt)
+char *pattern;
+mtpat *mt;
+  {
+  register char *p = pattern;
+  register int c;
+  unsigned bit = 1;
+  int pos = 0;
+  uint8_t set [32];
+
+  if (!mt_folded) mt_init_fold ();
+  memset (mt, 0, sizeof (mtpat));
+
+  while (*p)
+    {
+    if (*p == '*')
+      {
+      mt->star |= bit;
+      p++;
+      continue;
+      }
+
+    if (++pos > MT_MAXPOS)
+      {
+      /* Too long to match any name */
+      memset (mt, 0, sizeof (mtpat));
+      mt->accept = MT_NEVER;
+      return;
+      }
+    bit <<= 1;
+
+    if (*p == '?')
+      {
+      for (c = 1; c < MT_NCHARS; c++)
+        mt->b[c] |= bit;
+      mt->any |= bit;
+      p++;
+      }
+    else if (*p == '[')
+      {
+      p = mt_class (p + 1, set);
+      if (!p)
+        {
+        /* An unterminated class never matches */
+        memset (mt, 0, sizeof (mtpat));
+        mt->accept = MT_NEVER;
+        return;
+        }
+      for (c = 1; c < MT_NCHARS; c++)
+        if (set[mt_fold[c] >> 3] & (1 << (mt_fold[c] & 7)))
+          mt->b[c] |= bit;
+      }
+    else
+      {
+      int lit;
+      if (*p == '\\' && p[1]) p++;
+      lit = tolower ((uint8_t)*p++);
+      for (c = 1; c < MT_NCHARS; c++)
+        if (mt_fold[c] == lit)
+          mt->b[c] |= bit;
+      }
+    }
+  mt->accept = bit;
+  }
+
+/*===========================================================================
+
+  mt_pad
+
+  Follow the state d over up to n characters of padding, which only a
+  '?' (or a '*') can match, as in an FCB mask. Returns every state 
+  reached on the way.
+
+===========================================================================*/
+static unsigned mt_pad (mt, d, n)
+register mtpat *mt;
+register unsigned d;
+int n;
+  {
+  unsigned all = d;
+  while (n-- > 0 && d)
+    {
+    d = ((d << 1) & mt->any) | (d & mt->star);
+    all |= d;
+    }
+  return all;
+  }
+
+/*===========================================================================
+
+  mt_name
+
+  A blank extension is tried both ways: as no extension at all, and 
+  as a '.' followed by padding, so that "*.*" and "foo.???" match a 
+  name with no extension, as their FCB masks do.
+
+===========================================================================*/
+BOOL mt_name (mt, name)
+register mtpat *mt;
+char *name;
+  {
+  register unsigned d = 1;
+  unsigned star = mt->star;
+  int i, nlen, xlen;
+
+  for (nlen = 8; nlen > 0 && (name[nlen - 1] & CHAR_MASK) == ' '; nlen--);
+  for (xlen = 3; xlen > 0 && (name[7 + xlen] & CHAR_MASK) == ' '; xlen--);
+
+  for (i = 0; i < nlen && d; i++)
+    d = ((d << 1) & mt->b[name[i] & CHAR_MASK]) | (d & star);
+  d = mt_pad (mt, d, 8 - nlen);
+  if (!xlen && (d & mt->accept)) return TRUE;
+
+  d = ((d << 1) & mt->b['.']) | (d & star);
+  for (i = 8; i < 8 + xlen && d; i++)
+    d = ((d << 1) & mt->b[name[i] & CHAR_MASK]) | (d & star);
+  d = mt_pad (mt, d, 3 - xlen);
+  return (d & mt->accept) != 0;
+  }
+
+/*===========================================================================
+
+  mt_field
+
+  Compile one part of a filename pattern -- the name or the
+  extension -- into an FCB field of len characters. Returns a pointer
+  to the character that ended the part, or 0 if the part can't be
+  expressed as an FCB mask. *star is set if the part ended in '*'.
+
+===========================================================================*/
+static char *mt_field (p, mask, len, star)
+register char *p;
+char *mask;
+int len;
+BOOL *star;
+  {
+  int i = 0;
+  *star = FALSE;
+  while (*p && *p != '.')
+    {
+    if (*p == '*')
+      {
+      /* '*' fills the rest of the field, so it must end the part */
+      if (p[1] && p[1] != '.') return 0;
+      while (i < len) mask[i++] = '?';
+      *star = TRUE;
+      return p + 1;
+      }
+    if (*p == '[' || *p == '\\' || i == len) return 0;
+    mask[i++] = toupper (*p);
+    p++;
+    }
+  while (i < len) mask[i++] = ' ';
+  return p;
+  }
+
+/*===========================================================================
+
+  mt_mask
+
+  Try to compile a filename pattern into an 11-character FCB mask,
+  so that the BDOS search does the matching. This works for patterns
+  made only of ordinary characters, '?' and a '*' at the end of the
+  name or extension. A pattern with no extension that ends in '*', 
+  like "foo*", matches any extension. As in CP/M itself, a '?' also
+  matches the padding at the end of a short name.
+
+  Returns FALSE if the pattern needs mt_compile().
+
+===========================================================================*/
+BOOL mt_mask (pattern, mask)
+char *pattern;
+char *mask;
+  {
+  BOOL star;
+  char *p = mt_field (pattern, mask, 8, &star);
+  if (!p) return FALSE;
+  if (*p == '.')
+    {
+    p = mt_field (p + 1, mask + 8, 3, &star);
+    if (!p || *p) return FALSE;
+    }
+  else if (star)
+    memset (mask + 8, '?', 3);
+  else
+    memset (mask + 8, ' ', 3);
+  return TRUE;
+  }
+
+/*===========================================================================
+
+  mt_fcb
+
+===========================================================================*/
+BOOL mt_fcb (mask, name)
+register char *mask;
+register char *name;
+  {
+  register int i;
+  for (i = 0; i < BD_MAX_FNAME; i++)
+    if (mask[i] != '?' && mask[i] != (name[i] & CHAR_MASK)) 
+      return FALSE;
+  return TRUE;
+  }
+
@@ -0,0 +1,60 @@
+/*===========================================================================
+
+  match.h
+
+  Filename patterns, compiled for matching against 8.3 names
+
+  Copyright (c)2021 Kevin Boone, GPL v3.0
+
+===========================================================================*/
+#ifndef __MATCH_H
+#define __MATCH_H
+
+#include "defs.h"
+
+/* Characters in a name are seven bits; the top bit is an attribute */
+#define MT_NCHARS 128
+
+/* A name has at most 12 characters, so a pattern that needs more
+   than this can't match anything */
+#define MT_MAXPOS 12
+
+/* An accepting position that no name can reach */
+#define MT_NEVER (1 << (MT_MAXPOS + 1))
+
+/* A compiled pattern. Each character of the pattern, other than '*',
+   is a position, numbered from 1; bit 0 is the start of the 
+   pattern. */
+typedef struct _mtpat
+  {
+  unsigned b [MT_NCHARS]; /* Positions each character may fill */
+  unsigned star;          /* Positions followed by '*' */
+  unsigned any;           /* Positions filled by '?' */
+  unsigned accept;        /* The last position */
+  } mtpat;
+
+/** Compile a pattern, ignoring case: '?', '*', '[...]' classes with
+    ranges and '!' or '^', and '\' escapes. Args: char *pattern, 
+    mtpat *mt. */
+void mt_compile ();
+
+/** TRUE if a pattern matches a name in FCB form: 11 characters, space
+    padded, with attributes in the top bits. The name is matched as 
+    "name.ext", or "name" if the extension is blank. As in an FCB 
+    mask, a '?' or '*' may also match the padding at the end of the
+    name or extension, so "*.*" matches "name" and "foo?" matches 
+    "foo". Args: mtpat *mt, char *name. */
+BOOL mt_name ();
+
+/** Compile a filename pattern into an 11-character FCB mask, in upper
+    case, with '?' for any character. Args: char *pattern, char *mask.
+    Returns FALSE if the pattern can't be written as a mask, and needs
+    mt_compile(). */
+BOOL mt_mask ();
+
+/** TRUE if a name in FCB form matches an FCB mask from mt_mask(), as
+    it would in a BDOS search. Attributes in the name are ignored. 
+    Args: char *mask, char *name. */
+BOOL mt_fcb ();
+
+#endif /* match.h */
@@ -20,6 +20,14 @@
 #include "getopt.h"
 #include "error.h"
 #include "term.h"
+#include "recio.h"
+
+/* One file to rename */
+typedef struct _mvpair
+  {
+  dirent *d;
+  char to [BD_MAX_FNAME];
+  } mvpair;
 
 /*===========================================================================
 
@@ -29,7 +37,183 @@
 void mv_help ()
   {
   printf ("Usage: mv [old_name] [new_name]\r\n");
-  printf ("Rename a file.\r\n");
+  printf ("Rename a file, or files. With wildcards, e.g., ");
+  printf ("\"mv *.txt *.doc\", each\r\n");
+  printf ("'?' or '*' in the new name keeps that part of the old name.\r\n");
+  printf ("Nothing is renamed if any new name is already taken, even by\r\n");
+  printf ("a file that would itself be renamed, so \"mv a?.txt b?.txt\"\r\n");
+  printf ("fails if, e.g., both A1.TXT and B1.TXT exist.\r\n");
+  }
+
+/*===========================================================================
+
+  mv_parse
+
+  Split an argument into drive and pattern. A missing drive is the 
+  current one. Returns 0 if the drive letter isn't one of A-P.
+
+===========================================================================*/
+char *mv_parse (arg, drive)
+char *arg;
+Drive *drive;
+  {
+  if (arg[0] && arg[1] == ':')
+    {
+    if (!isalpha (arg[0])) return 0;
+    *drive = toupper (arg[0]) - 'A' + 1;
+    if (*drive > 16) return 0;
+    return arg + 2;
+    }
+  *drive = bd_cur_drv ();
+  return arg;
+  }
+
+/*===========================================================================
+
+  mv_name
+
+  Work out a file's new name from the new-name mask: each '?' keeps
+  the character of the old name in that place, as the CCP's REN would
+  if it took wildcards.
+
+===========================================================================*/
+void mv_name (d, mask, to)
+dirent *d;
+char *mask;
+char *to;
+  {
+  int i;
+  for (i = 0; i < BD_MAX_FNAME; i++)
+    to[i] = mask[i] == '?' ? d->name[i] : mask[i];
+  }
+
+/*===========================================================================
+
+  mv_same
+
+===========================================================================*/
+BOOL mv_same (n1, n2)
+char *n1;
+char *n2;
+  {
+  int i;
+  for (i = 0; i < BD_MAX_FNAME; i++)
+    if (n1[i] != n2[i]) return FALSE;
+  return TRUE;
+  }
+
+/*===========================================================================
+
+  mv_complain
+
+===========================================================================*/
+void mv_complain (drive, name, err)
+Drive drive;
+char *name;
+ErrCode err;
+  {
+  dirent t;
+  char path [BD_MAX_PATH + 1];
+  memcpy (t.name, name, BD_MAX_FNAME);
+  fprintf (stderr, "%s: %s\r\n", dirs_path (drive, &t, path), 
+    strerror (err));
+  }
+
+/*===========================================================================
+
+  mv_mv
+
+  Rename the files matching 'from' to the names given by 'to'. The 
+  drive's directory is read once, and every new name is worked out,
+  and checked, before anything is renamed: no new name may be the 
+  name of a file that is already there, or of another file being 
+  renamed, and no file may be read-only (which would stop the BDOS 
+  with an error). Each rename is then a single BDOS 23 call. Returns
+  zero, or an error code.
+
+===========================================================================*/
+ErrCode mv_mv (from, to)
+char *from;
+char *to;
+  {
+  Drive drive, tdrive;
+  char *fpat = mv_parse (from, &drive);
+  char *tpat = mv_parse (to, &tdrive);
+  char fmask [BD_MAX_FNAME];
+  char tmask [BD_MAX_FNAME];
+  mtpat mt;
+  BOOL masked;
+  dirlist *all;
+  mvpair *pairs;
+  ErrCode err = 0;
+  int i, j, n = 0, matched = 0;
+
+  if (!fpat || !tpat) return E_DLET;
+  if (drive != tdrive) return E_XDRV;
+  if (!*fpat || !*tpat || !mt_mask (tpat, tmask)) return E_FNAME;
+  masked = mt_mask (fpat, fmask);
+  if (!masked) mt_compile (fpat, &mt);
+
+  all = dirs_list (drive, "*", DST_NAME);
+  if (!all) return errno;
+  pairs = malloc ((all->n + 1) * sizeof (mvpair));
+  if (!pairs)
+    {
+    dirs_free (all);
+    return ENOMEM;
+    }
+
+  for (i = 0; i < all->n; i++)
+    {
+    dirent *d = &all->ents[i];
+    if (!dirs_match (d, fmask, masked ? 0 : &mt)) continue;
+    matched++;
+    mv_name (d, tmask, pairs[n].to);
+    if (mv_same (pairs[n].to, d->name)) continue;
+    pairs[n].d = d;
+    if (d->attr & DA_RO) 
+      {
+      mv_complain (drive, d->name, EACCES);
+      err = EACCES;
+      }
+    if (dirs_find (all, pairs[n].to))
+      {
+      mv_complain (drive, pairs[n].to, EEXIST);
+      err = EEXIST;
+      }
+    for (j = 0; j < n; j++)
+      if (mv_same (pairs[j].to, pairs[n].to))
+        {
+        mv_complain (drive, pairs[n].to, EEXIST);
+        err = EEXIST;
+        break;
+        }
+    n++;
+    }
+
+  /* Files that would keep their names aren't an error */
+  if (n == 0 && !err && matched)
+    printf ("%s: nothing to rename\r\n", from);
+  else if (n == 0 && !err)
+    {
+    fprintf (stderr, "%s: %s\r\n", from, strerror (ENOENT));
+    err = ENOENT;
+    }
+
+  /* The rename takes the attributes from the top bits of the new 
+     name, so keep the system and archive bits. */
+  for (i = 0; i < n && !err; i++)
+    {
+    dirent *d = pairs[i].d;
+    if (d->attr & DA_SYS) pairs[i].to[9] |= ATTR_MASK;
+    if (d->attr & DA_ARC) pairs[i].to[10] |= ATTR_MASK;
+    err = rio_ren (drive, d->name, pairs[i].to);
+    if (err) mv_complain (drive, pairs[i].d->name, err);
+    }
+
+  free (pairs);
+  dirs_free (all);
+  return err;
   }
 
 /*===========================================================================
@@ -58,19 +242,17 @@ char **argv;
 
   if (argc - optind == 2)
     {
-    char *from = argv[optind];
-    char *to = argv[optind + 1];
-
-    FILE *f = fopen (from, "r");
-    if (f)
-      {
-      fclose (f);
-      rename (from, to);
-      }
-    else
+    ErrCode err = mv_mv (argv[optind], argv[optind + 1]);
+    if (err == E_DLET)
       {
-      fprintf (stderr, "%s: %s\r\n", from, strerror (ENOENT));
+      Drive drive;
+      char *bad = mv_parse (argv[optind], &drive) 
+        ? argv[optind + 1] : argv[optind];
+      fprintf (stderr, "%c: %s\r\n", bad[0], strerror (err));
       }
+    else if (err == E_XDRV || err == E_FNAME)
+      fprintf (stderr, "%s: %s\r\n", argv[optind + 1], strerror (err));
+    if (err) exit (err);
     }
   else
     {
@@ -81,4 +263,3 @@ char **argv;
   return 0;
   }
 
-
@@ -0,0 +1,249 @@
+/*===========================================================================
+
+  recio.c
+
+  The library's open()/read()/write() and stdio keep their own record
+  buffer, and copy every byte through it on the way to and from the
+  BDOS. Here the DMA address is pointed straight at each record of the
+  caller's buffer in turn, so the BDOS reads and writes it in place.
+  Errors the library would keep to itself (a full disk or directory,
+  a failed close) are passed back.
+
+  On CP/M 3, BDOS 44 sets a multi-sector count, and then a single
+  read or write moves up to 128 consecutive records to or from the
+  DMA address. That lets the BDOS transfer whole blocks, or tracks,
+  in one BIOS call. The count is put back to 1 afterwards, because 
+  the library's own I/O expects it.
+
+  Copyright (c)2021 Kevin Boone, GPL v3.0
+
+===========================================================================*/
+
+#include "stdio.h"
+#include "errno.h"
+#include "defs.h"
+#include "bdos.h"
+#include "error.h"
+#include "compat.h"
+#include "recio.h"
+
+/*===========================================================================
+
+  rio_fcb
+
+  Set up an FCB for path, which may have a drive. The library's
+  fcbinit() does the parsing.
+
+===========================================================================*/
+static ErrCode rio_fcb (fcb, path)
+uint8_t *fcb;
+char *path;
+  {
+  int i;
+  memset (fcb, 0, 36);
+  fcbinit (path, fcb);
+  if (fcb[1] == ' ') return E_FNAME;
+  for (i = 1; i <= BD_MAX_FNAME; i++)
+    if (fcb[i] == '?') return E_FNAME;
+  /* fcbinit() leaves 0 for the current drive */
+  if (fcb[0] == 0) fcb[0] = bd_cur_drv ();
+  return 0;
+  }
+
+/*===========================================================================
+
+  rio_open
+
+===========================================================================*/
+ErrCode rio_open (rf, path)
+riofile *rf;
+char *path;
+  {
+  ErrCode err = rio_fcb (rf->fcb, path);
+  rf->err = 0;
+  if (err) return err;
+  if ((bdos (BDOS_OPEN, rf->fcb) & 0xFF) == 0xFF) return ENOENT;
+  rf->fcb[32] = 0;
+  return 0;
+  }
+
+/*===========================================================================
+
+  rio_create
+
+===========================================================================*/
+ErrCode rio_create (rf, path)
+riofile *rf;
+char *path;
+  {
+  ErrCode err = rio_fcb (rf->fcb, path);
+  rf->err = 0;
+  if (err) return err;
+  bdos (BDOS_DELETE, rf->fcb);
+  if ((bdos (BDOS_MAKE, rf->fcb) & 0xFF) == 0xFF) return E_DIRF;
+  rf->fcb[32] = 0;
+  return 0;
+  }
+
+/*===========================================================================
+
+  rio_xfer
+
+  Read or write nrecs records with BDOS function fn. Any non-zero 
+  return is an error, and returned in *r; for a multi-sector transfer,
+  H then holds the number of records that were moved.
+
+===========================================================================*/
+static unsigned rio_xfer (rf, fn, buf, nrecs, r)
+riofile *rf;
+int fn;
+uint8_t *buf;
+unsigned nrecs;
+int *r;
+  {
+  unsigned n = 0;
+  *r = 0;
+  if (bd_ver () >= 0x30)
+    {
+    while (n < nrecs)
+      {
+      unsigned k = nrecs - n;
+      unsigned ret;
+      if (k > BD_MAX_MULTI) k = BD_MAX_MULTI;
+      bdos (BDOS_MULTI, k);
+      bdos (BDOS_SETDMA, buf);
+      ret = bdos (fn, rf->fcb);
+      if (ret & 0xFF)
+        {
+        n += (ret >> 8) & 0xFF;
+        *r = ret & 0xFF;
+        break;
+        }
+      n += k;
+      buf += k * BD_SEC_SZ;
+      }
+    bdos (BDOS_MULTI, 1);
+    }
+  else
+    {
+    for (; n < nrecs; n++, buf += BD_SEC_SZ)
+      {
+      bdos (BDOS_SETDMA, buf);
+      if ((*r = bdos (fn, rf->fcb) & 0xFF)) break;
+      }
+    }
+  bdos (BDOS_SETDMA, DMABUF);
+  return n;
+  }
+
+/*===========================================================================
+
+  rio_read
+
+  BDOS 20 returns 1 at the end of the file; anything else non-zero is
+  a real error (CP/M 3 only -- CP/M 2.2 gives up with a BDOS error).
+
+===========================================================================*/
+unsigned rio_read (rf, buf, nrecs)
+riofile *rf;
+uint8_t *buf;
+unsigned nrecs;
+  {
+  int r;
+  unsigned n = rio_xfer (rf, BDOS_READ, buf, nrecs, &r);
+  if (r && r != 1) rf->err = E_IO;
+  return n;
+  }
+
+/*===========================================================================
+
+  rio_write
+
+===========================================================================*/
+unsigned rio_write (rf, buf, nrecs)
+riofile *rf;
+uint8_t *buf;
+unsigned nrecs;
+  {
+  int r;
+  unsigned n = rio_xfer (rf, BDOS_WRITE, buf, nrecs, &r);
+  /* 1 is no directory space for a new extent, 2 no data block */
+  if (r) rf->err = r == 1 ? E_DIRF : r == 2 ? E_DISKF : E_IO;
+  return n;
+  }
+
+/*===========================================================================
+
+  rio_size
+
+  Records above 65535 would only be possible on an 8Mb CP/M 2.2 file
+  of exactly that size.
+
+===========================================================================*/
+unsigned rio_size (rf)
+riofile *rf;
+  {
+  bdos (BDOS_FSIZE, rf->fcb);
+  return rf->fcb[33] | ((unsigned)rf->fcb[34] << 8);
+  }
+
+/*===========================================================================
+
+  rio_rread
+
+  The random read sets the FCB's extent and current record to rec, 
+  but doesn't move past it, so sequential access carries on from 
+  there. 
+
+===========================================================================*/
+ErrCode rio_rread (rf, rec, buf)
+riofile *rf;
+unsigned rec;
+uint8_t *buf;
+  {
+  int r;
+  rf->fcb[33] = rec & 0xFF;
+  rf->fcb[34] = rec >> 8;
+  rf->fcb[35] = 0;
+  bdos (BDOS_SETDMA, buf);
+  r = bdos (BDOS_RREAD, rf->fcb) & 0xFF;
+  bdos (BDOS_SETDMA, DMABUF);
+  return r ? E_IO : 0;
+  }
+
+/*===========================================================================
+
+  rio_close
+
+===========================================================================*/
+ErrCode rio_close (rf)
+riofile *rf;
+  {
+  if ((bdos (BDOS_CLOSE, rf->fcb) & 0xFF) == 0xFF) return E_IO;
+  return 0;
+  }
+
+/*===========================================================================
+
+  rio_ren
+
+  BDOS 23 takes the old name at FCB+1 and the new at FCB+17. It will
+  happily make a second file with the new name, so the caller must
+  check first that there isn't one.
+
+===========================================================================*/
+ErrCode rio_ren (drive, from, to)
+Drive drive;
+char *from;
+char *to;
+  {
+  uint8_t fcb [36];
+  memset (fcb, 0, sizeof (fcb));
+  fcb[0] = drive;
+  memcpy (fcb + 1, from, BD_MAX_FNAME);
+  fcb[16] = drive;
+  memcpy (fcb + 17, to, BD_MAX_FNAME);
+  if ((bdos (BDOS_RENAME, fcb) & 0xFF) == 0xFF) return ENOENT;
+  return 0;
+  }
+
@@ -0,0 +1,65 @@
+/*===========================================================================
+
+  recio.h
+
+  Sequential file I/O straight through the BDOS, 128-byte record at a
+  time, into and out of the caller's own buffer.
+
+  Copyright (c)2021 Kevin Boone, GPL v3.0
+
+===========================================================================*/
+#ifndef __RECIO_H
+#define __RECIO_H
+
+#include "defs.h"
+#include "error.h"
+
+/* The CP/M end-of-file marker for text files */
+#define RIO_EOF 0x1A
+
+typedef struct _riofile
+  {
+  uint8_t fcb [36];
+  ErrCode err;    /* Set by a failed read or write; end-of-file isn't */
+  } riofile;
+
+/** Open an existing file for reading. Args: riofile *rf, char *path.
+    Returns zero, or an error code. */
+extern ErrCode rio_open ();
+
+/** Create a file for writing, replacing any file of the same name.
+    Args: riofile *rf, char *path. Returns zero, or an error code. */
+extern ErrCode rio_create ();
+
+/** Read up to nrecs records into buf. Args: riofile *rf, 
+    uint8_t *buf, unsigned nrecs. Returns the number read, which is 
+    less than nrecs at the end of the file, or if rf->err is set. */
+extern unsigned rio_read ();
+
+/** Write nrecs records from buf. Args: riofile *rf, uint8_t *buf,
+    unsigned nrecs. Returns the number written; if it's less than 
+    nrecs, rf->err says why. */
+extern unsigned rio_write ();
+
+/** The size of an open file, in records, from BDOS 35. Args: 
+    riofile *rf. */
+extern unsigned rio_size ();
+
+/** Read record rec into buf with a random read (BDOS 33). The next
+    rio_read() or rio_write() is then of the same record. Args: 
+    riofile *rf, unsigned rec, uint8_t *buf. Returns zero, or an 
+    error code. */
+extern ErrCode rio_rread ();
+
+/** Close the file. For a file that has been written, this is when
+    the directory is updated, so it can fail. Returns zero, or an
+    error code. */
+extern ErrCode rio_close ();
+
+/** Rename a file. Args: Drive drive (A=1, B=2...), char *from, 
+    char *to, where the names are raw, 11-character FCB names. The 
+    top bits of the new name's characters are its attributes. 'to' 
+    must not exist. Returns zero, or an error code. */
+extern ErrCode rio_ren ();
+
+#endif /* recio.h */
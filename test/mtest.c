@@ -0,0 +1,361 @@
+/*===========================================================================
+
+  test/mtest.c
+
+  Host-side test of the filename matchers in match.c. Every pattern 
+  that can be an FCB mask is matched against the same names both as
+  a mask, the way the BDOS search matches it, and through 
+  mt_compile(), and the two must agree. A few patterns that only the
+  compiled matcher can take are checked against known answers.
+
+  "mtest bench" also times mt_name() against the old recursive 
+  fnmatch(), on the same names and patterns.
+
+  Build and run on the host with "make mtest".
+
+  Copyright (c)2021 Kevin Boone, GPL v3.0
+
+===========================================================================*/
+
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include "defs.h"
+#include "bdos.h"
+#include "match.h"
+
+#define FNM_NOMATCH     -1
+#define FNM_LEADING_DIR 0x0001 
+#define FNM_NOESCAPE    0x0002 
+#define FNM_PERIOD      0x0004 
+#define FNM_FILE_NAME   0x0008 
+#define FNM_CASEFOLD    0x0010 
+
+#define BENCH_LOOPS 20000
+
+static char *names[] = 
+  {
+  "FOO", "FOO.TXT", "FOO.T", "FOOD.TXT", "FOO1.TXT", "FO", "F", 
+  "A.C", "A.H", "README", "ABCDEFGH.IJK", "X.TX", "ZZ.Z", 
+  "CP.COM", "DIRS.C", 0
+  };
+
+/* Patterns that mt_mask() must take */
+static char *masks[] = 
+  {
+  "*", "*.*", "FOO", "FOO?", "FOO*", "FOO.*", "FOO.???", "FOO?.TXT",
+  "*.T?", "*.T??", "F??", "?", "????????.???", "*.C", "FOO.", "*.",
+  "F*.T*", "foo.txt", "?.?", "A.?", 0
+  };
+
+/* Patterns that need mt_compile(), and the names they match */
+typedef struct _mtcase
+  {
+  char *pattern;
+  char *name;
+  BOOL match;
+  } mtcase;
+
+static mtcase cases[] =
+  {
+  { "[F]OO?", "FOO", TRUE },
+  { "[F]OO?", "FOOD.TXT", FALSE },
+  { "[A-Z]*.*", "README", TRUE },
+  { "[a-z]*.*", "FOO.TXT", TRUE },
+  { "*.[CH]", "A.C", TRUE },
+  { "*.[CH]", "FOO", FALSE },
+  { "*.[CH]?", "A.C", TRUE },
+  { "[!F]*", "FOO.TXT", FALSE },
+  { "[!F]*", "README", TRUE },
+  { "F*[0-9].TXT", "FOO1.TXT", TRUE },
+  { "F*[0-9].TXT", "FOO.TXT", FALSE },
+  { "[F]O", "FOO", FALSE },
+  { "[F]OO.[T]??", "FOO.T", TRUE },
+  { 0, 0, FALSE }
+  };
+
+/*===========================================================================
+
+  to_fcb
+
+  Write "name.ext" as an 11-character FCB name, upper case and space
+  padded.
+
+===========================================================================*/
+static void to_fcb (s, fcb)
+char *s;
+char *fcb;
+  {
+  int i = 0;
+  memset (fcb, ' ', BD_MAX_FNAME);
+  while (*s && *s != '.' && i < 8) fcb[i++] = toupper (*s++);
+  if (*s == '.') s++;
+  for (i = 8; *s && i < BD_MAX_FNAME; s++) fcb[i++] = toupper (*s);
+  }
+
+/*===========================================================================
+
+  ref_fnmatch
+
+  The recursive matcher that mt_compile() replaced, kept only as the
+  baseline for the timing.
+
+===========================================================================*/
+static int ref_fnmatch (pattern, string, flags)
+char *pattern;
+char *string;
+int flags;
+  {
+  register char *p = pattern, *n = string;
+  register unsigned char c;
+
+#define FOLD(c)	((flags & FNM_CASEFOLD) ? tolower (c) : (c))
+
+  while ((c = *p++) != '\0')
+    {
+      c = FOLD (c);
+
+      switch (c)
+	{
+	case '?':
+	  if (*n == '\0')
+	    return FNM_NOMATCH;
+	  else if ((flags & FNM_FILE_NAME) && *n == '/')
+	    return FNM_NOMATCH;
+	  else if ((flags & FNM_PERIOD) && *n == '.' &&
+		   (n == string || ((flags & FNM_FILE_NAME) && n[-1] == '/')))
+	    return FNM_NOMATCH;
+	  break;
+
+	case '\\':
+	  if (!(flags & FNM_NOESCAPE))
+	    {
+	      c = *p++;
+	      c = FOLD (c);
+	    }
+	  if (FOLD ((unsigned char)*n) != c)
+	    return FNM_NOMATCH;
+	  break;
+
+	case '*':
+	  if ((flags & FNM_PERIOD) && *n == '.' &&
+	      (n == string || ((flags & FNM_FILE_NAME) && n[-1] == '/')))
+	    return FNM_NOMATCH;
+
+	  for (c = *p++; c == '?' || c == '*'; c = *p++, ++n)
+	    if (((flags & FNM_FILE_NAME) && *n == '/') ||
+		(c == '?' && *n == '\0'))
+	      return FNM_NOMATCH;
+
+	  if (c == '\0')
+	    return 0;
+
+	  {
+	    unsigned char c1 = (!(flags & FNM_NOESCAPE) && c == '\\') ? *p : c;
+	    c1 = FOLD (c1);
+	    for (--p; *n != '\0'; ++n)
+	      if ((c == '[' || FOLD ((unsigned char)*n) == c1) &&
+		  ref_fnmatch (p, n, flags & ~FNM_PERIOD) == 0)
+		return 0;
+	    return FNM_NOMATCH;
+	  }
+
+	case '[':
+	  {
+	    /* Nonzero if the sense of the character class is inverted.  */
+	    register int negate;
+
+	    if (*n == '\0')
+	      return FNM_NOMATCH;
+
+	    if ((flags & FNM_PERIOD) && *n == '.' &&
+		(n == string || ((flags & FNM_FILE_NAME) && n[-1] == '/')))
+	      return FNM_NOMATCH;
+
+	    negate = (*p == '!' || *p == '^');
+	    if (negate)
+	      ++p;
+
+	    c = *p++;
+	    for (;;)
+	      {
+		register unsigned char cstart = c, cend = c;
+
+		if (!(flags & FNM_NOESCAPE) && c == '\\')
+		  cstart = cend = *p++;
+
+		cstart = cend = FOLD (cstart);
+
+		if (c == '\0')
+		  /* [ (unterminated) loses.  */
+		  return FNM_NOMATCH;
+
+		c = *p++;
+		c = FOLD (c);
+
+		if ((flags & FNM_FILE_NAME) && c == '/')
+		  /* [/] can never match.  */
+		  return FNM_NOMATCH;
+
+		if (c == '-' && *p != ']')
+		  {
+		    cend = *p++;
+		    if (!(flags & FNM_NOESCAPE) && cend == '\\')
+		      cend = *p++;
+		    if (cend == '\0')
+		      return FNM_NOMATCH;
+		    cend = FOLD (cend);
+
+		    c = *p++;
+		  }
+
+		if (FOLD ((unsigned char)*n) >= cstart
+		    && FOLD ((unsigned char)*n) <= cend)
+		  goto matched;
+
+		if (c == ']')
+		  break;
+	      }
+	    if (!negate)
+	      return FNM_NOMATCH;
+	    break;
+
+	  matched:;
+	    /* Skip the rest of the [...] that already matched.  */
+	    while (c != ']')
+	      {
+		if (c == '\0')
+		  /* [... (unterminated) loses.  */
+		  return FNM_NOMATCH;
+
+		c = *p++;
+		if (!(flags & FNM_NOESCAPE) && c == '\\')
+		  /* XXX 1003.2d11 is unclear if this is right.  */
+		  ++p;
+	      }
+	    if (negate)
+	      return FNM_NOMATCH;
+	  }
+	  break;
+
+	default:
+	  if (c != FOLD ((unsigned char)*n))
+	    return FNM_NOMATCH;
+	}
+
+      ++n;
+    }
+
+  if (*n == '\0')
+    return 0;
+
+  if ((flags & FNM_LEADING_DIR) && *n == '/')
+    /* The FNM_LEADING_DIR flag says that "foo*" matches "foobar/frobozz".  */
+    return 0;
+
+  return FNM_NOMATCH;
+  }
+
+/*===========================================================================
+
+  bench
+
+===========================================================================*/
+static void bench ()
+  {
+  static char *pats[] = { "*.*", "FOO?", "*.T?", "[A-F]*.C*", 
+    "F*[0-9].TXT", "*X*.*", 0 };
+  char fcbs [sizeof (names) / sizeof (char *)][BD_MAX_FNAME];
+  mtpat mts [sizeof (pats) / sizeof (char *)];
+  clock_t t;
+  long hits1 = 0, hits2 = 0;
+  int i, j, k;
+
+  /* dirs.c has the names in FCB form already, and compiles each 
+     pattern once for the whole directory */
+  for (j = 0; names[j]; j++)
+    to_fcb (names[j], fcbs[j]);
+  for (i = 0; pats[i]; i++)
+    mt_compile (pats[i], &mts[i]);
+
+  t = clock ();
+  for (k = 0; k < BENCH_LOOPS; k++)
+    for (i = 0; pats[i]; i++)
+      for (j = 0; names[j]; j++)
+        if (ref_fnmatch (pats[i], names[j], FNM_CASEFOLD) == 0) hits1++;
+  printf ("fnmatch:    %.3f s\n", (double)(clock () - t) / CLOCKS_PER_SEC);
+
+  t = clock ();
+  for (k = 0; k < BENCH_LOOPS; k++)
+    for (i = 0; pats[i]; i++)
+      for (j = 0; names[j]; j++)
+        if (mt_name (&mts[i], fcbs[j])) hits2++;
+  printf ("mt_name:    %.3f s\n", 
+    (double)(clock () - t) / CLOCKS_PER_SEC);
+  /* These differ: fnmatch() doesn't let "*.*" match a name with no
+     extension, or "foo?" match "foo" */
+  printf ("matches:    %ld, %ld\n", hits1, hits2);
+  }
+
+/*===========================================================================
+
+  main
+
+===========================================================================*/
+int main (argc, argv)
+int argc;
+char **argv;
+  {
+  int i, j, fails = 0, tests = 0;
+  char mask [BD_MAX_FNAME];
+  char fcb [BD_MAX_FNAME];
+  mtpat mt;
+
+  for (i = 0; masks[i]; i++)
+    {
+    if (!mt_mask (masks[i], mask))
+      {
+      printf ("%s: not compiled as a mask\n", masks[i]);
+      fails++;
+      continue;
+      }
+    mt_compile (masks[i], &mt);
+    for (j = 0; names[j]; j++)
+      {
+      BOOL m1, m2;
+      to_fcb (names[j], fcb);
+      /* The top bits are attributes, and must be ignored */
+      fcb[9] |= ATTR_MASK;
+      m1 = mt_fcb (mask, fcb);
+      m2 = mt_name (&mt, fcb);
+      tests++;
+      if (m1 != m2)
+        {
+        printf ("%s %s: mask %d, compiled %d\n", masks[i], names[j], 
+          m1, m2);
+        fails++;
+        }
+      }
+    }
+
+  for (i = 0; cases[i].pattern; i++)
+    {
+    BOOL m;
+    mt_compile (cases[i].pattern, &mt);
+    to_fcb (cases[i].name, fcb);
+    m = mt_name (&mt, fcb);
+    tests++;
+    if (m != cases[i].match)
+      {
+      printf ("%s %s: got %d, expected %d\n", cases[i].pattern, 
+        cases[i].name, m, cases[i].match);
+      fails++;
+      }
+    }
+
+  printf ("%d tests, %d failed\n", tests, fails);
+  if (argc > 1 && strcmp (argv[1], "bench") == 0) bench ();
+  return fails != 0;
+  }
+
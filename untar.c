@@ -10,7 +10,6 @@
 ===========================================================================*/
 
 #include "stdio.h"
-#include "fcntl.h"
 #include "errno.h"
 #include "ctype.h"
 #include "config.h"
@@ -19,11 +18,16 @@
 #include "bdos.h"
 #include "getopt.h"
 #include "error.h"
+#include "recio.h"
 
 #define DF_VERB 0x01
 #define DF_T 0x02
 
-char buff[512];
+/* Size of a tar header or data block, and of the buffer, in records */
+#define UT_BLK_RECS 4
+#define UT_BUF_RECS 32
+
+char buff[UT_BUF_RECS * BD_SEC_SZ];
 
 /*===========================================================================
 
@@ -111,29 +115,34 @@ char *p;
 
   untar_do_untar 
 
+  The archive is read, and the files written, with the BDOS, straight
+  from the buffer. File data is moved several tar blocks at a time. A
+  file's last record is padded with ^Z.
+
 ===========================================================================*/
 void untar_untar (tarfile, odrive, d_flag)
 char *tarfile;
 Drive odrive;
 uint8_t d_flag;
   {
-  FILE *a;
-  a = fopen (tarfile, "r");
-  if (!a)
+  riofile a, f;
+  ErrCode err;
+  err = rio_open (&a, tarfile);
+  if (err)
     {
-    fprintf (stderr, "%s: %s\r\n", tarfile, strerror (errno));
+    fprintf (stderr, "%s: %s\r\n", tarfile, strerror (err));
     return;
     }
 
   for (;;)
     {
-    FILE *f = NULL;
+    BOOL out = FALSE;
     long filesize;
-    int bytes_read = fread (buff, 1, sizeof (buff), a);
-    if (bytes_read < sizeof (buff)) 
+    unsigned recs_read = rio_read (&a, buff, UT_BLK_RECS);
+    if (recs_read < UT_BLK_RECS) 
       {
       fprintf (stderr,  "Short read: expected %d, got %d\r\n",
-         sizeof (buff), (int)bytes_read);
+         UT_BLK_RECS * BD_SEC_SZ, recs_read * BD_SEC_SZ);
          return;
       }
     if (is_end_of_archive (buff)) 
@@ -163,46 +172,61 @@ uint8_t d_flag;
           }
         else
           {
+          char path [3 + 100];
+          path[0] = odrive - 1 + 'A';
+          path[1] = ':';
+          strncpy (path + 2, buff, 100);
+          path[2 + 100] = 0;
           if (d_flag & DF_VERB)
-            printf ("Extracting file '%s'\r\n", buff);
-          f = fopen (buff, "w");
-          if (!f)
-            {
-            fprintf (stderr, "%s: %s\r\n", buff, strerror (errno));
-            }
+            printf ("Extracting file '%s'\r\n", path);
+          err = rio_create (&f, path);
+          if (err)
+            fprintf (stderr, "%s: %s\r\n", path, strerror (err));
+          else
+            out = TRUE;
           }
         break;
       }
     while (filesize > 0) 
       {
-      bytes_read = fread (buff, 1, sizeof(buff), a);
-      if (bytes_read < sizeof (buff)) 
+      /* Whole tar blocks to read, and records of data to write */
+      unsigned nrecs = UT_BUF_RECS;
+      unsigned wrecs;
+      if (filesize < (long)UT_BUF_RECS * BD_SEC_SZ)
+        nrecs = ((unsigned)filesize + UT_BLK_RECS * BD_SEC_SZ - 1) 
+          / (UT_BLK_RECS * BD_SEC_SZ) * UT_BLK_RECS;
+      recs_read = rio_read (&a, buff, nrecs);
+      if (recs_read < nrecs) 
           {
           fprintf (stderr, "Short read: Expected %d, got %d\r\n",
-             sizeof (buff), (int)bytes_read);
+             nrecs * BD_SEC_SZ, recs_read * BD_SEC_SZ);
            return;
            }
-      if (filesize < (int)sizeof (buff))
-            bytes_read = filesize;
-      if (f) 
+      wrecs = nrecs;
+      if (filesize < (long)nrecs * BD_SEC_SZ)
         {
-        if (fwrite (buff, 1, bytes_read, f) != (int)bytes_read)
+        unsigned used = (unsigned)filesize;
+        wrecs = (used + BD_SEC_SZ - 1) / BD_SEC_SZ;
+        memset (buff + used, RIO_EOF, wrecs * BD_SEC_SZ - used);
+        }
+      if (out) 
+        {
+        if (rio_write (&f, buff, wrecs) < wrecs)
           {
-          fprintf (stderr, "Failed write: %s\r\n", strerror (errno));
-          fclose (f);
-          f = NULL;
+          fprintf (stderr, "Failed write: %s\r\n", strerror (f.err));
+          rio_close (&f);
+          out = FALSE;
           }
         }
-      filesize -= bytes_read;
+      filesize -= (long)nrecs * BD_SEC_SZ;
       }
-    if (f) 
+    if (out) 
       {
-      fclose (f);
-      f = NULL;
+      if ((err = rio_close (&f)))
+        fprintf (stderr, "Failed close: %s\r\n", strerror (err));
+      out = FALSE;
       }
     }
-
-  fclose (a);
   }
 
 /*===========================================================================